@@ -0,0 +1,485 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2023 Happy_Arno
+static const char *help =
+    "A benchmark for mc-playtime-calc with synthetic minecraft logs\n"
+    "Usage:\n"
+    "    mc-playtime-bench --tool <mc-playtime-calc> [<options>]\n"
+    "Options:\n"
+    "    --tool <path>         The mc-playtime-calc executable to measure\n"
+    "    --baseline <path>     Another mc-playtime-calc executable that the speedup is reported against\n"
+    "    --dir <path>          The directory of the generated logs (default: bench-corpus)\n"
+    "    --files <n>           The number of rotated .log.gz files (default: 200)\n"
+    "    --lines <n>           The number of lines in each rotated log file (default: 20000)\n"
+    "    --line-length <n>     The average length of a line in bytes (default: 120)\n"
+    "    --level <n>           The gzip compression level from 1 to 9 (default: 6)\n"
+    "    --plain-lines <n>     The number of lines in the uncompressed latest.log (default: 500000)\n"
+    "    --jobs <n>            The number of jobs passed to mc-playtime-calc for the directory (default: 1)\n"
+    "    --runs <n>            The number of runs of which the fastest counts (default: 3)\n";
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <zlib.h>
+#include "mcplaytime.h"
+#ifdef _WIN32
+#include <io.h>
+#define NULL_DEVICE "NUL"
+#else
+#define NULL_DEVICE "/dev/null"
+#endif
+/**
+ * @brief The parameters of a generated corpus.
+ */
+typedef struct
+{
+    long files;       /**< The number of rotated log files. */
+    long lines;       /**< The number of lines in each rotated log file. */
+    long lineLength;  /**< The average length of a line. */
+    int level;        /**< The gzip compression level. */
+    long plainLines;  /**< The number of lines in `latest.log`. */
+} CorpusConfig;
+/**
+ * @brief The size of a generated corpus.
+ */
+typedef struct
+{
+    long long gzBytes;     /**< The decompressed size of the rotated log files. */
+    long long gzLines;     /**< The number of lines in the rotated log files. */
+    long long gzFirst;     /**< The decompressed size of the first rotated log file. */
+    long long plainBytes;  /**< The size of `latest.log`. */
+    long long plainLines;  /**< The number of lines in `latest.log`. */
+} CorpusSize;
+/** The state of the pseudo-random number generator. */
+static unsigned long long seed = 0x9E3779B97F4A7C15ull;
+/**
+ * @brief Get the next pseudo-random number.
+ * @return Return a pseudo-random number.
+ */
+unsigned long long nextRandom()
+{
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    return seed;
+}
+/**
+ * @brief Create a directory unless it exists.
+ * @param[in] path The path to the directory.
+ * @return Return 0 on success, or -1 on failure.
+ */
+int makeDirectory(const char *path)
+{
+#ifdef _WIN32
+    int ret = mkdir(path);
+#else
+    int ret = mkdir(path, 0755);
+#endif
+    return ret == 0 || errno == EEXIST ? 0 : -1;
+}
+/**
+ * @brief Generate one line of a synthetic log.
+ * @param[out] line A buffer of at least `2 * lineLength + 64` bytes.
+ * @param[in] time The time of the line in seconds since midnight.
+ * @param[in] lineLength The average length of a line.
+ * @return Return the length of the line including the line feed.
+ */
+size_t generateLine(char *line, long time, long lineLength)
+{
+    static const char *threads[] = {"Render thread/INFO", "Server thread/INFO", "Worker-Main-3/WARN", "main/INFO"};
+    static const char words[] = "abcdefghijklmnopqrstuvwxyz ABCDEFGHIJKLMNOPQRSTUVWXYZ 0123456789 .:/";
+    size_t length;
+    // About one line in ten is a stack trace line without a timestamp.
+    if (nextRandom() % 10 == 0)
+        length = sprintf(line, "\tat net.minecraft.class_%d.method_%d(SourceFile:%d)",
+                         (int)(nextRandom() % 9000), (int)(nextRandom() % 9000), (int)(nextRandom() % 900));
+    else
+        length = sprintf(line, "[%02ld:%02ld:%02ld] [%s]: ", time / 3600 % 24, time / 60 % 60, time % 60,
+                         threads[nextRandom() % 4]);
+    size_t target = lineLength / 2 + nextRandom() % (lineLength + 1);
+    while (length < target)
+        line[length++] = words[nextRandom() % (sizeof(words) - 1)];
+    line[length++] = '\n';
+    return length;
+}
+/**
+ * @brief Generate a synthetic log file.
+ * @param[in] path The path to the log file.
+ * @param[in] mode The mode for `gzopen()`, e.g. "wb6" for gzip or "wbT" for uncompressed output.
+ * @param[in] lines The number of lines.
+ * @param[in] lineLength The average length of a line.
+ * @param[out] bytes A pointer for adding the number of written bytes to.
+ * @return Return 0 on success, or -1 on failure.
+ */
+int generateFile(const char *path, const char *mode, long lines, long lineLength, long long *bytes)
+{
+    gzFile gf = gzopen(path, mode);
+    if (gf == NULL)
+        return -1;
+    gzbuffer(gf, 256 * 1024);
+    char *line = malloc(2 * lineLength + 64);
+    long time = 3600 * (nextRandom() % 12);
+    int ret = line == NULL ? -1 : 0;
+    for (long i = 0; ret == 0 && i < lines; i++)
+    {
+        size_t length = generateLine(line, time, lineLength);
+        if (gzwrite(gf, line, length) != (int)length)
+            ret = -1;
+        *bytes += length;
+        time += nextRandom() % 3;
+    }
+    free(line);
+    if (gzclose(gf) != Z_OK)
+        ret = -1;
+    return ret;
+}
+/**
+ * @brief Generate a `.minecraft` directory with synthetic logs unless a matching one exists.
+ * @param[in] dir The directory to generate the corpus in.
+ * @param[in] config The parameters of the corpus.
+ * @param[out] size A pointer for outputting the size of the corpus.
+ * @return Return 0 on success, or -1 on failure.
+ */
+int generateCorpus(const char *dir, const CorpusConfig *config, CorpusSize *size)
+{
+    char path[4096], stamp[256], existing[256] = "";
+    sprintf(stamp, "%ld %ld %ld %d %ld\n", config->files, config->lines, config->lineLength, config->level,
+            config->plainLines);
+    snprintf(path, sizeof(path), "%s/corpus.txt", dir);
+    FILE *file = fopen(path, "r");
+    if (file != NULL)
+    {
+        int ok = fgets(existing, sizeof(existing), file) != NULL && strcmp(existing, stamp) == 0 &&
+                 fscanf(file, "%lld %lld %lld %lld %lld", &size->gzBytes, &size->gzLines, &size->gzFirst,
+                        &size->plainBytes, &size->plainLines) == 5;
+        fclose(file);
+        if (ok)
+            return 0;
+    }
+    memset(size, 0, sizeof(CorpusSize));
+    if (makeDirectory(dir) != 0)
+        return -1;
+    snprintf(path, sizeof(path), "%s/.minecraft", dir);
+    if (makeDirectory(path) != 0)
+        return -1;
+    snprintf(path, sizeof(path), "%s/.minecraft/logs", dir);
+    if (makeDirectory(path) != 0)
+        return -1;
+    char mode[8];
+    sprintf(mode, "wb%d", config->level);
+    for (long i = 0; i < config->files; i++)
+    {
+        long long bytes = 0;
+        snprintf(path, sizeof(path), "%s/.minecraft/logs/%04ld-%02ld-%02ld-%ld.log.gz", dir, 2013 + i / 336,
+                 i / 28 % 12 + 1, i % 28 + 1, 1L);
+        if (generateFile(path, mode, config->lines, config->lineLength, &bytes) != 0)
+            return -1;
+        size->gzBytes += bytes;
+        size->gzLines += config->lines;
+        if (i == 0)
+            size->gzFirst = bytes;
+    }
+    snprintf(path, sizeof(path), "%s/.minecraft/logs/latest.log", dir);
+    if (generateFile(path, "wbT", config->plainLines, config->lineLength, &size->plainBytes) != 0)
+        return -1;
+    size->plainLines = config->plainLines;
+    snprintf(path, sizeof(path), "%s/corpus.txt", dir);
+    if ((file = fopen(path, "w")) == NULL)
+        return -1;
+    fprintf(file, "%s%lld %lld %lld %lld %lld\n", stamp, size->gzBytes, size->gzLines, size->gzFirst,
+            size->plainBytes, size->plainLines);
+    return fclose(file) == 0 ? 0 : -1;
+}
+/**
+ * @brief Get the current time in seconds.
+ * @return Return the time from an arbitrary point in seconds.
+ */
+double now()
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+/**
+ * @brief Run a command several times and measure the fastest run.
+ * @param[in] command The command to run with its output discarded.
+ * @param[in] runs The number of runs.
+ * @return Return the wall time of the fastest run in seconds, or a negative number on failure.
+ */
+double measure(const char *command, int runs)
+{
+    double best = -1;
+    for (int i = 0; i < runs; i++)
+    {
+        double start = now();
+        if (system(command) != 0)
+            return -1;
+        double time = now() - start;
+        if (best < 0 || time < best)
+            best = time;
+    }
+    return best;
+}
+/**
+ * @brief Measure mc-playtime-calc on part of the corpus and print the throughput.
+ * @param[in] name The name of the case.
+ * @param[in] tool The path to the mc-playtime-calc executable.
+ * @param[in] baseline The path to the executable that the speedup is reported against, or NULL.
+ * @param[in] args The arguments of mc-playtime-calc.
+ * @param[in] runs The number of runs.
+ * @param[in] bytes The number of decompressed bytes parsed.
+ * @param[in] lines The number of lines parsed.
+ * @param[in] files The number of files parsed.
+ * @return Return 0 on success, or -1 on failure.
+ */
+int runCase(const char *name, const char *tool, const char *baseline, const char *args, int runs, long long bytes,
+            long long lines, long long files)
+{
+    char command[8192];
+    double time = -1, base = -1;
+    // The runs of both executables alternate, so that a change of the load of the machine affects them alike.
+    for (int i = 0; i < runs; i++)
+    {
+        snprintf(command, sizeof(command), "\"%s\" --no-cache %s > " NULL_DEVICE, tool, args);
+        double next = measure(command, 1);
+        if (next >= 0 && baseline != NULL)
+        {
+            double baseNext;
+            snprintf(command, sizeof(command), "\"%s\" --no-cache %s > " NULL_DEVICE, baseline, args);
+            if ((baseNext = measure(command, 1)) < 0)
+                next = -1;
+            else if (base < 0 || baseNext < base)
+                base = baseNext;
+        }
+        if (next < 0)
+        {
+            fprintf(stderr, "ERROR: %s: Fail to run %s\n", name, command);
+            return -1;
+        }
+        if (time < 0 || next < time)
+            time = next;
+    }
+    printf("%-12s %9.3f s %10.1f MB/s %12.0f lines/s %10.1f files/s", name, time, bytes / 1e6 / time, lines / time,
+           files / time);
+    if (baseline != NULL)
+        printf(" %7.3f s baseline %6.2fx", base, base / time);
+    printf("\n");
+    return 0;
+}
+/** The number of line feeds that the newline kernels are asked for at once, as many as the scanner asks for. */
+#define KERNEL_BATCH 16
+/**
+ * @brief Find the line feeds of a text one byte at a time in batches.
+ * @param[in] data The text.
+ * @param[in] size The size of the text.
+ * @return Return the sum of the offsets of the line feeds, so that the work can't be left out.
+ */
+unsigned long long findWithLoop(const char *data, size_t size)
+{
+    size_t offsets[KERNEL_BATCH], count = 0;
+    unsigned long long sum = 0;
+    for (size_t i = 0; i < size; i++)
+        if (data[i] == '\n')
+        {
+            offsets[count++] = i;
+            if (count == KERNEL_BATCH)
+                for (; count > 0; count--)
+                    sum += offsets[count - 1];
+        }
+    for (; count > 0; count--)
+        sum += offsets[count - 1];
+    return sum;
+}
+/**
+ * @brief Find the line feeds of a text with one `memchr()` per line in batches.
+ * @param[in] data The text.
+ * @param[in] size The size of the text.
+ * @return Return the sum of the offsets of the line feeds.
+ */
+unsigned long long findWithMemchr(const char *data, size_t size)
+{
+    size_t offsets[KERNEL_BATCH], count = 0;
+    unsigned long long sum = 0;
+    for (const char *p = data, *end = data + size; (p = memchr(p, '\n', end - p)) != NULL; p++)
+    {
+        offsets[count++] = p - data;
+        if (count == KERNEL_BATCH)
+            for (; count > 0; count--)
+                sum += offsets[count - 1];
+    }
+    for (; count > 0; count--)
+        sum += offsets[count - 1];
+    return sum;
+}
+/**
+ * @brief Find the line feeds of a text with the newline kernel of mc-playtime-calc in batches.
+ * @param[in] data The text.
+ * @param[in] size The size of the text.
+ * @return Return the sum of the offsets of the line feeds.
+ */
+unsigned long long findWithKernel(const char *data, size_t size)
+{
+    size_t offsets[KERNEL_BATCH], count, position = 0;
+    unsigned long long sum = 0;
+    do
+    {
+        count = mcFindNewlines(data + position, size - position, offsets, KERNEL_BATCH);
+        for (size_t i = 0; i < count; i++)
+            sum += position + offsets[i];
+        if (count > 0)
+            position += offsets[count - 1] + 1;
+    } while (count == KERNEL_BATCH);
+    return sum;
+}
+/**
+ * @brief Measure a way of finding line feeds on a text in memory and print the throughput.
+ * @param[in] name The name of the case.
+ * @param[in] find The function finding the line feeds.
+ * @param[in] data The text.
+ * @param[in] size The size of the text.
+ * @param[in] runs The number of runs.
+ * @param[in] expected The sum of the offsets of the line feeds, or 0 if it isn't known yet.
+ * @return Return the sum of the offsets found.
+ */
+unsigned long long runKernel(const char *name, unsigned long long (*find)(const char *, size_t), const char *data,
+                             size_t size, int runs, unsigned long long expected)
+{
+    double best = -1;
+    unsigned long long sum = 0;
+    for (int i = 0; i < runs; i++)
+    {
+        double start = now();
+        sum = find(data, size);
+        double time = now() - start;
+        if (best < 0 || time < best)
+            best = time;
+    }
+    printf("%-20s %9.3f s %10.1f MB/s%s\n", name, best, size / 1e6 / best,
+           expected != 0 && sum != expected ? " (WRONG RESULT)" : "");
+    return sum;
+}
+/**
+ * @brief Compare the newline kernel with a byte loop and with `memchr()` on an uncompressed log.
+ * @param[in] path The path to the log.
+ * @param[in] runs The number of runs.
+ * @return Return 0 on success, or -1 on failure.
+ */
+int runKernels(const char *path, int runs)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+        return -1;
+    char *data = NULL;
+    size_t size = 0;
+    if (fseek(file, 0, SEEK_END) == 0 && ftell(file) > 0 && (data = malloc(ftell(file))) != NULL)
+    {
+        size = ftell(file);
+        rewind(file);
+        size = fread(data, 1, size, file);
+    }
+    fclose(file);
+    if (data == NULL)
+        return -1;
+    char name[64];
+    snprintf(name, sizeof(name), "kernel (%s)", mcNewlineKernel());
+    unsigned long long expected = runKernel("byte loop", findWithLoop, data, size, runs, 0);
+    runKernel("memchr", findWithMemchr, data, size, runs, expected);
+    runKernel(name, findWithKernel, data, size, runs, expected);
+    free(data);
+    return 0;
+}
+/**
+ * @brief Parse a positive integer option.
+ * @param[in] name The name of the option.
+ * @param[in] value The value of the option.
+ * @return Return the value, or -1 on failure.
+ */
+long parseCount(const char *name, const char *value)
+{
+    char *end;
+    long n = value != NULL ? strtol(value, &end, 10) : 0;
+    if (value == NULL || *value == '\0' || *end != '\0' || n < 1)
+    {
+        fprintf(stderr, "ERROR: Invalid value of %s: %s\n", name, value != NULL ? value : "");
+        return -1;
+    }
+    return n;
+}
+int main(int argc, char *argv[])
+{
+    CorpusConfig config = {200, 20000, 120, 6, 500000};
+    const char *tool = NULL, *baseline = NULL, *dir = "bench-corpus";
+    long jobs = 1, runs = 3, level = 6;
+    for (int i = 1; i < argc; i++)
+    {
+        const char *option = argv[i], *value = i + 1 < argc ? argv[i + 1] : NULL;
+        long *count = NULL;
+        if (strcmp(option, "--tool") == 0 && value != NULL)
+            tool = argv[++i];
+        else if (strcmp(option, "--baseline") == 0 && value != NULL)
+            baseline = argv[++i];
+        else if (strcmp(option, "--dir") == 0 && value != NULL)
+            dir = argv[++i];
+        else if (strcmp(option, "--files") == 0)
+            count = &config.files;
+        else if (strcmp(option, "--lines") == 0)
+            count = &config.lines;
+        else if (strcmp(option, "--line-length") == 0)
+            count = &config.lineLength;
+        else if (strcmp(option, "--level") == 0)
+            count = &level;
+        else if (strcmp(option, "--plain-lines") == 0)
+            count = &config.plainLines;
+        else if (strcmp(option, "--jobs") == 0)
+            count = &jobs;
+        else if (strcmp(option, "--runs") == 0)
+            count = &runs;
+        else
+        {
+            printf(help);
+            return 1;
+        }
+        if (count != NULL && (i++, *count = parseCount(option, value)) == -1)
+            return 1;
+    }
+    if (tool == NULL)
+    {
+        printf(help);
+        return 1;
+    }
+    if (level > 9)
+    {
+        fprintf(stderr, "ERROR: Invalid value of --level: %ld\n", level);
+        return 1;
+    }
+    config.level = level;
+    CorpusSize size;
+    printf("generating corpus in %s\n", dir);
+    if (generateCorpus(dir, &config, &size) != 0)
+    {
+        fprintf(stderr, "ERROR: %s: Fail to generate corpus: %s\n", dir, strerror(errno));
+        return 1;
+    }
+    printf("%ld rotated files of %ld lines, %lld MB decompressed; latest.log of %ld lines, %lld MB\n",
+           config.files, config.lines, size.gzBytes / 1000000, config.plainLines, size.plainBytes / 1000000);
+    if (baseline != NULL)
+        printf("speedup against %s\n", baseline);
+    char args[4096];
+    int ret = 0;
+    snprintf(args, sizeof(args), "\"%s/.minecraft/logs/2013-01-01-1.log.gz\"", dir);
+    ret |= runCase("single .gz", tool, baseline, args, runs, size.gzFirst, config.lines, 1);
+    snprintf(args, sizeof(args), "\"%s/.minecraft/logs/latest.log\"", dir);
+    ret |= runCase("single plain", tool, baseline, args, runs, size.plainBytes, size.plainLines, 1);
+    snprintf(args, sizeof(args), "-j %ld \"%s/.minecraft/logs\"", jobs, dir);
+    ret |= runCase("directory", tool, baseline, args, runs, size.gzBytes + size.plainBytes,
+                   size.gzLines + size.plainLines, config.files + 1);
+    printf("newline search in latest.log:\n");
+    snprintf(args, sizeof(args), "%s/.minecraft/logs/latest.log", dir);
+    if (runKernels(args, runs) != 0)
+    {
+        fprintf(stderr, "ERROR: %s: %s\n", args, strerror(errno));
+        ret = -1;
+    }
+    return ret == 0 ? 0 : 1;
+}
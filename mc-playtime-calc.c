@@ -3,308 +3,3254 @@
 static const char *help =
     "A tool to calculate your playtime in minecraft by parsing logs\n"
     "Usage:\n"
-    "    mc-playtime-calc [<log file>] [<logs dir>] [<.minecraft dir>] ...\n"
+    "    mc-playtime-calc [<options>] [<log file>] [<logs dir>] [<.minecraft dir>] ...\n"
+    "Options:\n"
+    "    -j <jobs>   Parse up to <jobs> log files at once (default: 1)\n"
+    "    --no-cache  Neither read nor update the cache of rotated log files\n"
+    "    --follow    Keep following latest.log and print the total time whenever it changes\n"
+    "    --stats     Print the time taken by each phase and other counters to stderr\n"
+    "    --gap <seconds>\n"
+    "                Don't count gaps longer than <seconds> between two lines as playtime (default: 0, no limit)\n"
+    "    --join <text>\n"
+    "                Only count playtime after lines containing <text>, which may be given several times\n"
+    "    --leave <text>\n"
+    "                Stop counting playtime at lines containing <text>, which may be given several times\n"
+    "    --since <date>, --until <date>\n"
+    "                Only parse the log files of the days from or until <date>, which is yyyy, yyyy-MM or\n"
+    "                yyyy-MM-dd\n"
+    "    --profile <name>\n"
+    "                Only parse the logs of versions/<name> in a .minecraft directory, which may be given several\n"
+    "                times\n"
+    "    --format <format>\n"
+    "                Print text (default), jsonl or csv with the path, start, end, duration, sessions and bytes of\n"
+    "                each file\n"
+    "    --tail-seek Take the end time of uncompressed logs from their tail, and of gzip logs of several members\n"
+    "                from their last member, without reading the rest (faster, but only correct for logs spanning\n"
+    "                at most one midnight)\n"
+    "    --prefetch  Read log files ahead of the parsing threads with asynchronous I/O\n"
+    "    --max-memory <MiB>\n"
+    "                Keep the log files read ahead and the buffers of the parsing threads within <MiB>, streaming\n"
+    "                the files that don't fit\n"
+    "    --serve <socket>\n"
+    "                Keep following the logs like --follow and answer the queries total, profile [<name>] and\n"
+    "                day <date> on the Unix socket <socket> from memory\n"
+    "    --histogram Also print the playtime of each day and of each hour of the day, with jsonl as one object\n"
+    "                per day and per hour\n"
+    "    --lazy      Print a provisional total from the cache right away, with the changed log files estimated, then\n"
+    "                parse them newest first and print the exact result\n"
+    "    --multi-root\n"
+    "                Walk all paths at once with up to <jobs> threads and count each log file only once, even if\n"
+    "                several paths reach it\n"
     "Example:\n"
     "    mc-playtime-calc .\n"
     "    mc-playtime-calc ./.minecraft\n"
     "    mc-playtime-calc ./.minecraft/logs\n"
     "    mc-playtime-calc ./.minecraft/logs/latest.log\n"
-    "    mc-playtime-calc ./version1/logs ./version2/logs\n";
+    "    mc-playtime-calc ./version1/logs ./version2/logs\n"
+    "    mc-playtime-calc -j 8 ./.minecraft\n"
+    "    mc-playtime-calc -j 8 --prefetch ./.minecraft\n"
+    "    mc-playtime-calc -j 8 --prefetch --max-memory 64 ./.minecraft\n"
+    "    mc-playtime-calc -j 8 --multi-root /srv/players/*/.minecraft\n"
+    "    mc-playtime-calc --gap 300 ./.minecraft\n"
+    "    mc-playtime-calc --histogram --since 2023 ./.minecraft\n"
+    "    mc-playtime-calc -j 8 --lazy --multi-root /srv/players/*/.minecraft\n"
+    "    mc-playtime-calc --since 2023-05 --until 2023-05 --profile 1.20 ./.minecraft\n"
+    "    mc-playtime-calc --format=jsonl ./.minecraft\n";
 #include <stdio.h>
-#include <dirent.h>
 #include <sys/stat.h>
-#include <zlib.h>
+#include "mcplaytime.h"
 #include <string.h>
 #include <time.h>
 #include <ctype.h>
 #include <stdlib.h>
-#include <libgen.h>
+#include <stddef.h>
+#include <stdarg.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#ifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#endif
+#ifdef USE_AIO
+#include <aio.h>
+#endif
+#ifndef _WIN32
+#include <dirent.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/resource.h>
+#include <sys/mman.h>
+#endif
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+/** The options of parsing, including the number of log files parsed at once. */
+McOptions options;
+/** The parser of the current thread, which is created on first use. */
+_Thread_local McParser *threadParser = NULL;
+#ifdef ENABLE_STATS
+/** The number of slowest files reported by `--stats`. */
+#define SLOWEST_FILES 10
+/** The names of the phases. */
+const char *phaseNames[MC_PHASE_COUNT] = {"enumerate", "open", "inflate", "scan"};
 /**
- * @brief Extract a time by parsing the timestamp from a line in a log file.
- * @param[in] gf An opened `gzFile` object.
- * @param[out] time A `time_t` pointer for outputting time.
- * @return Return 0 on success, or 1 on failure.
+ * @brief A file that has taken long to parse.
+ */
+typedef struct
+{
+    double wall;  /**< The wall time taken. */
+    char *path;   /**< The path to the file. */
+} SlowFile;
+/**
+ * @brief The counters reported by `--stats`.
+ */
+typedef struct
+{
+    McStats phases;                         /**< The time of each phase and the bytes and lines scanned. */
+    long long files;                        /**< The number of parsed files. */
+    long long cachedFiles;                  /**< The number of files whose result comes from the cache. */
+    long long peakPrefetchBytes;            /**< The most bytes of log files read ahead at once. */
+    SlowFile slowest[SLOWEST_FILES];        /**< The slowest files, slowest first. */
+    int slowestCount;                       /**< The number of slowest files. */
+} Stats;
+/** Whether the statistics are collected and reported. */
+int showStats = 0;
+/** The statistics of the current thread that haven't been merged yet. */
+_Thread_local Stats threadStats;
+/** The merged statistics of all threads. */
+Stats totalStats;
+/** The mutex protecting `totalStats`. */
+pthread_mutex_t statsMutex = PTHREAD_MUTEX_INITIALIZER;
+/**
+ * @brief Record a file in a list of the slowest files if it is slow enough.
+ * @param[in,out] stats The statistics holding the list.
+ * @param[in] wall The wall time taken by the file.
+ * @param[in] path The path to the file, which is copied if it is recorded, or taken over if `owned` is nonzero.
+ * @param[in] owned Whether the path has been allocated for the list.
  */
-int parseLine(gzFile gf, time_t *time)
+void addSlowFile(Stats *stats, double wall, const char *path, int owned)
 {
-    const char *tag = "[hh:mm:ss]";
-    time_t hour = 0, minute = 0, second = 0;
-    int ch;
-    for (int i = 0; tag[i] != '\0'; i++)
+    int i = stats->slowestCount;
+    if (i == SLOWEST_FILES && wall <= stats->slowest[i - 1].wall)
     {
-        ch = gzgetc(gf);
-        if (ch == EOF)
-            return 1;
-        if (tag[i] == 'h' || tag[i] == 'm' || tag[i] == 's')
-        {
-            if (!isdigit(ch))
-                return 1;
-            if (tag[i] == 'h')
-                hour = hour * 10 + (ch - '0');
-            else if (tag[i] == 'm')
-                minute = minute * 10 + (ch - '0');
-            else
-                second = second * 10 + (ch - '0');
-        }
-        else if (ch != tag[i])
-            return 1;
+        if (owned)
+            free((char *)path);
+        return;
+    }
+    char *copy = owned ? (char *)path : strdup(path);
+    if (copy == NULL)
+        return;
+    if (i == SLOWEST_FILES)
+        free(stats->slowest[--i].path);
+    else
+        stats->slowestCount++;
+    for (; i > 0 && stats->slowest[i - 1].wall < wall; i--)
+        stats->slowest[i] = stats->slowest[i - 1];
+    stats->slowest[i].wall = wall;
+    stats->slowest[i].path = copy;
+}
+/**
+ * @brief Add the counters of the parser of the current thread to its statistics.
+ */
+void collectParserStats()
+{
+    if (threadParser != NULL)
+        mcCollectStats(threadParser, &threadStats.phases);
+}
+/**
+ * @brief Merge the statistics of the current thread into the total.
+ */
+void mergeStats()
+{
+    collectParserStats();
+    pthread_mutex_lock(&statsMutex);
+    for (int i = 0; i < MC_PHASE_COUNT; i++)
+    {
+        totalStats.phases.wall[i] += threadStats.phases.wall[i];
+        totalStats.phases.cpu[i] += threadStats.phases.cpu[i];
+    }
+    totalStats.phases.compressedBytes += threadStats.phases.compressedBytes;
+    totalStats.phases.decompressedBytes += threadStats.phases.decompressedBytes;
+    totalStats.phases.lines += threadStats.phases.lines;
+    totalStats.files += threadStats.files;
+    totalStats.cachedFiles += threadStats.cachedFiles;
+    if (threadStats.peakPrefetchBytes > totalStats.peakPrefetchBytes)
+        totalStats.peakPrefetchBytes = threadStats.peakPrefetchBytes;
+    for (int i = 0; i < threadStats.slowestCount; i++)
+        addSlowFile(&totalStats, threadStats.slowest[i].wall, threadStats.slowest[i].path, 1);
+    pthread_mutex_unlock(&statsMutex);
+    memset(&threadStats, 0, sizeof(Stats));
+}
+/**
+ * @brief Print the merged statistics.
+ * @param[in] elapsed The wall time of the whole run.
+ */
+void printStats(double elapsed)
+{
+    mergeStats();
+    fprintf(stderr, "statistics (wall and CPU time summed over all threads):\n");
+    for (int i = 0; i < MC_PHASE_COUNT; i++)
+        fprintf(stderr, "    %-10s %12.6f s wall %12.6f s cpu\n", phaseNames[i], totalStats.phases.wall[i],
+                totalStats.phases.cpu[i]);
+    fprintf(stderr, "    elapsed    %12.6f s wall\n", elapsed);
+    fprintf(stderr, "    files: %lld (%lld from cache)\n", totalStats.files, totalStats.cachedFiles);
+    fprintf(stderr, "    compressed bytes: %lld\n", totalStats.phases.compressedBytes);
+    fprintf(stderr, "    decompressed bytes: %lld\n", totalStats.phases.decompressedBytes);
+    fprintf(stderr, "    lines: %lld\n", totalStats.phases.lines);
+    fprintf(stderr, "    peak prefetched bytes: %lld\n", totalStats.peakPrefetchBytes);
+#ifndef _WIN32
+    struct rusage usage;
+    // The peak resident set size is reported in kilobytes, except on macOS where it is in bytes.
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+#ifdef __APPLE__
+        fprintf(stderr, "    peak resident memory: %lld KiB\n", (long long)usage.ru_maxrss / 1024);
+#else
+        fprintf(stderr, "    peak resident memory: %lld KiB\n", (long long)usage.ru_maxrss);
+#endif
+#endif
+    if (totalStats.slowestCount > 0)
+        fprintf(stderr, "    slowest files:\n");
+    for (int i = 0; i < totalStats.slowestCount; i++)
+    {
+        fprintf(stderr, "    %12.6f s %s\n", totalStats.slowest[i].wall, totalStats.slowest[i].path);
+        free(totalStats.slowest[i].path);
+    }
+    totalStats.slowestCount = 0;
+}
+#define STATS_CLOCK(name) McClock name
+#define STATS_START(name) do { if (showStats) mcStartClock(&(name), &threadStats.phases); } while (0)
+#define STATS_STOP(name, phase) do { if (showStats) mcStopClock(&(name), &threadStats.phases, phase); } while (0)
+#define STATS_ADD(field, value) do { if (showStats) threadStats.field += (value); } while (0)
+#define STATS_PEAK(field, value) do { if (showStats && (value) > threadStats.field) threadStats.field = (value); } while (0)
+#define STATS_FILE(name, path) do { if (showStats) addSlowFile(&threadStats, mcReadClock(CLOCK_MONOTONIC) - (name).wall, path, 0); } while (0)
+#define STATS_MERGE() do { if (showStats) mergeStats(); } while (0)
+#else
+#define STATS_CLOCK(name)
+#define STATS_START(name) do { } while (0)
+#define STATS_STOP(name, phase) do { } while (0)
+#define STATS_ADD(field, value) do { } while (0)
+#define STATS_PEAK(field, value) do { } while (0)
+#define STATS_FILE(name, path) do { } while (0)
+#define STATS_MERGE() do { } while (0)
+#endif
+/**
+ * @brief A cached result of parsing a rotated log file.
+ */
+typedef struct
+{
+    char *path;         /**< The absolute path to the log file. */
+    McFileStamp stamp;  /**< The version of the file that has been parsed. */
+    McSummary summary;  /**< The result of parsing. */
+} CacheEntry;
+/** The magic number at the start of a cache index file. */
+#define CACHE_MAGIC "MCPTCACH"
+/** The version of the format of cache index files. */
+#define CACHE_VERSION 5
+/**
+ * @brief The header of a cache index file, which is followed by the records sorted by path and then by the paths.
+ * @note The index is written in the byte order of the machine that uses it.
+ */
+typedef struct
+{
+    char magic[8];        /**< `CACHE_MAGIC`. */
+    uint32_t version;     /**< `CACHE_VERSION`. */
+    uint32_t recordSize;  /**< The size of a record. */
+    uint64_t signature;   /**< The hash of the options that the results have been computed with. */
+    uint64_t count;       /**< The number of records. */
+    uint64_t poolSize;    /**< The size of the string pool holding the paths. */
+} CacheHeader;
+/**
+ * @brief The result of a log file in a cache index file.
+ */
+typedef struct
+{
+    uint64_t path;                             /**< The offset of the path in the string pool. */
+    uint64_t inode;                            /**< The inode number of the log file. */
+    int64_t size;                              /**< The size of the log file. */
+    int64_t mtime;                             /**< The modification time of the log file. */
+    int64_t start;                             /**< The first timestamp. */
+    int64_t end;                               /**< The last timestamp. */
+    int64_t time;                              /**< The playtime. */
+    int64_t bytes;                             /**< The number of bytes of log text covered. */
+    int32_t days;                              /**< The number of midnights passed. */
+    int32_t sessions;                          /**< The number of sessions. */
+    int32_t active;                            /**< Whether a session is still open at the end. */
+    uint32_t length;                           /**< The length of the path without its null terminator. */
+    int32_t histogramDays[MC_HISTOGRAM_DAYS];  /**< The playtime on each day. */
+    int32_t histogramHours[24];                /**< The playtime within each hour of the day. */
+} CacheRecord;
+/**
+ * @brief A cache index file mapped into memory.
+ */
+typedef struct
+{
+    void *data;                  /**< The content of the file, or NULL if there is none. */
+    size_t size;                 /**< The size of the file. */
+    const CacheRecord *records;  /**< The records sorted by path. */
+    size_t count;                /**< The number of records. */
+    const char *pool;            /**< The string pool. */
+    size_t poolSize;             /**< The size of the string pool. */
+} CacheIndex;
+/**
+ * @brief The results of parsing rotated log files in previous runs, and those to be saved for the next runs.
+ */
+typedef struct
+{
+    CacheIndex index;     /**< The index file as it has been loaded. */
+    CacheEntry *entries;  /**< The new entries in the order they have been added. */
+    size_t count;         /**< The number of new entries. */
+    size_t capacity;      /**< The number of entries that fit in `entries`. */
+    int dirty;            /**< Whether the cache has to be saved. */
+} Cache;
+/** The results cached on disk. */
+Cache resultCache = {.entries = NULL};
+/** Whether the results cached on disk are used. */
+int useCache = 1;
+/**
+ * @brief Get the path to the cache index file.
+ * @return Return the newly allocated path, or NULL on failure.
+ */
+char *getCachePath()
+{
+    const char *base = getenv("XDG_CACHE_HOME"), *suffix = "/mc-playtime-calc/index";
+    char *path;
+#ifdef _WIN32
+    if (base == NULL || *base == '\0')
+        base = getenv("LOCALAPPDATA");
+#endif
+    if (base != NULL && *base != '\0')
+    {
+        if ((path = malloc(strlen(base) + strlen(suffix) + 1)) != NULL)
+            strcat(strcpy(path, base), suffix);
+        return path;
+    }
+    if ((base = getenv("HOME")) == NULL || *base == '\0')
+        return NULL;
+    if ((path = malloc(strlen(base) + strlen("/.cache") + strlen(suffix) + 1)) != NULL)
+        strcat(strcat(strcpy(path, base), "/.cache"), suffix);
+    return path;
+}
+/**
+ * @brief Create the missing parent directories of a path.
+ * @param[in] path The path whose parent directories are created.
+ */
+void makeParentDirectories(const char *path)
+{
+    char *copy = strdup(path);
+    if (copy == NULL)
+        return;
+    for (char *p = copy + 1; *p != '\0'; p++)
+    {
+        if (*p != '/' && *p != '\\')
+            continue;
+        char separator = *p;
+        *p = '\0';
+#ifdef _WIN32
+        mkdir(copy);
+#else
+        mkdir(copy, 0755);
+#endif
+        *p = separator;
+    }
+    free(copy);
+}
+/**
+ * @brief Compare two cache entries by path, and then by modification time, for `qsort()`.
+ */
+int compareCacheEntry(const void *a, const void *b)
+{
+    const CacheEntry *x = a, *y = b;
+    int order = strcmp(x->path, y->path);
+    return order != 0 ? order : (x->stamp.mtime > y->stamp.mtime) - (x->stamp.mtime < y->stamp.mtime);
+}
+/**
+ * @brief Append an entry to the cache.
+ * @param[in,out] cache The cache.
+ * @param[in] entry The entry whose path has already been allocated for the cache.
+ * @return Return 0 on success, or -1 on failure.
+ */
+int appendCacheEntry(Cache *cache, const CacheEntry *entry)
+{
+    if (cache->count == cache->capacity)
+    {
+        size_t capacity = cache->capacity == 0 ? 256 : cache->capacity * 2;
+        CacheEntry *entries = realloc(cache->entries, capacity * sizeof(CacheEntry));
+        if (entries == NULL)
+            return -1;
+        cache->entries = entries, cache->capacity = capacity;
     }
-    *time = (hour * 60 + minute) * 60 + second;
-    while ((ch = gzgetc(gf)) != EOF && ch != '\r' && ch != '\n');
-    while ((ch = gzgetc(gf)) != EOF && (ch == '\r' || ch == '\n'));
-    if (ch != EOF)
-        gzungetc(ch, gf);
+    cache->entries[cache->count++] = *entry;
     return 0;
 }
+/** The initial value of an FNV-1a hash. */
+#define HASH_BASIS 14695981039346656037ULL
 /**
- * @brief Parse a minecraft log file and calculate the playtime recorded by the log.
- * @param[in] path The path to the minecraft log file.
- * @param[out] time A `time_t` pointer for outputting time.
- * @return Return 0 on success, 1 on system failure, or 2 on parsing failure.
+ * @brief Add a string to an FNV-1a hash.
+ * @param[in] hash The hash so far.
+ * @param[in] text The string.
+ * @return Return the new hash.
+ */
+unsigned long long hashText(unsigned long long hash, const char *text)
+{
+    for (; *text != '\0'; text++)
+        hash = (hash ^ (unsigned char)*text) * 1099511628211ULL;
+    return hash;
+}
+/**
+ * @brief Get a hash of the options that affect the result of parsing a log file.
+ * @return Return the hash.
+ * @note The results in an index are only valid for the options they have been computed with.
+ */
+unsigned long long getCacheSignature(void)
+{
+    unsigned long long hash = HASH_BASIS;
+    char text[64];
+    sprintf(text, "%lld %d", (long long)options.sessionGap, options.tailSeek);
+    hash = hashText(hash, text);
+    for (int i = 0; i < options.joinMarkerCount + options.leaveMarkerCount; i++)
+    {
+        int join = i < options.joinMarkerCount;
+        hash = hashText(hash, join ? "j" : "l");
+        hash = hashText(hash, join ? options.joinMarkers[i] : options.leaveMarkers[i - options.joinMarkerCount]);
+        hash = (hash ^ 0) * 1099511628211ULL;
+    }
+    return hash;
+}
+/**
+ * @brief Close a cache index file.
+ * @param[in,out] index The index file, which is left empty.
+ */
+void closeCacheIndex(CacheIndex *index)
+{
+    if (index->data != NULL)
+#ifdef _WIN32
+        free(index->data);
+#else
+        munmap(index->data, index->size);
+#endif
+    memset(index, 0, sizeof(CacheIndex));
+}
+/**
+ * @brief Open a cache index file by mapping it into memory, or by reading it where `mmap()` isn't available.
+ * @param[out] index The index file, which is left empty on failure.
+ * @param[in] path The path to the index file.
+ * @return Return 0 on success, or -1 if the file is missing, malformed or written with other options.
+ * @note Only the header is checked, so that opening takes the same time for any number of records. The paths are
+ * checked as they are read.
+ */
+int openCacheIndex(CacheIndex *index, const char *path)
+{
+    memset(index, 0, sizeof(CacheIndex));
+    int fd = open(path, O_RDONLY | O_BINARY);
+    struct stat status;
+    if (fd == -1)
+        return -1;
+    if (fstat(fd, &status) != 0 || (unsigned long long)status.st_size < sizeof(CacheHeader) ||
+        (unsigned long long)status.st_size > SIZE_MAX)
+    {
+        close(fd);
+        return -1;
+    }
+    index->size = status.st_size;
+#ifdef _WIN32
+    size_t done = 0;
+    if ((index->data = malloc(index->size)) != NULL)
+        for (int got; done < index->size && (got = read(fd, (char *)index->data + done, index->size - done)) > 0;)
+            done += got;
+    if (index->data != NULL && done != index->size)
+    {
+        free(index->data);
+        index->data = NULL;
+    }
+#else
+    if ((index->data = mmap(NULL, index->size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED)
+        index->data = NULL;
+#endif
+    close(fd);
+    if (index->data == NULL)
+        return -1;
+    const CacheHeader *header = index->data;
+    size_t space = index->size - sizeof(CacheHeader);
+    if (memcmp(header->magic, CACHE_MAGIC, 8) != 0 || header->version != CACHE_VERSION ||
+        header->recordSize != sizeof(CacheRecord) || header->signature != getCacheSignature() ||
+        header->count > space / sizeof(CacheRecord) || header->poolSize != space - header->count * sizeof(CacheRecord))
+    {
+        closeCacheIndex(index);
+        return -1;
+    }
+    index->records = (const CacheRecord *)(header + 1);
+    index->count = header->count;
+    index->pool = (const char *)(index->records + index->count);
+    index->poolSize = header->poolSize;
+    return 0;
+}
+/**
+ * @brief Get the path of a record of a cache index file.
+ * @param[in] index The index file.
+ * @param[in] record The record.
+ * @return Return the path, or NULL if the record is malformed.
+ */
+const char *getRecordPath(const CacheIndex *index, const CacheRecord *record)
+{
+    if (record->path >= index->poolSize || record->length >= index->poolSize - record->path ||
+        index->pool[record->path + record->length] != '\0')
+        return NULL;
+    return index->pool + record->path;
+}
+/**
+ * @brief Read a record of a cache index file into a cache entry.
+ * @param[in] index The index file.
+ * @param[in] record The record.
+ * @param[out] entry The entry, whose path points into the index file.
+ * @return Return 0 on success, or -1 if the record is malformed.
+ */
+int readCacheRecord(const CacheIndex *index, const CacheRecord *record, CacheEntry *entry)
+{
+    if ((entry->path = (char *)getRecordPath(index, record)) == NULL)
+        return -1;
+    entry->stamp.inode = record->inode, entry->stamp.size = record->size, entry->stamp.mtime = record->mtime;
+    McSummary *summary = &entry->summary;
+    summary->start = record->start, summary->end = record->end, summary->time = record->time;
+    summary->days = record->days, summary->sessions = record->sessions, summary->active = record->active;
+    summary->bytes = record->bytes;
+    for (int i = 0; i < MC_HISTOGRAM_DAYS; i++)
+        summary->histogram.days[i] = record->histogramDays[i];
+    for (int i = 0; i < 24; i++)
+        summary->histogram.hours[i] = record->histogramHours[i];
+    return 0;
+}
+/**
+ * @brief Load the cache from an index file. A missing or malformed file leaves the cache empty.
+ * @param[out] cache The cache.
+ * @param[in] path The path to the index file.
+ */
+void loadCache(Cache *cache, const char *path)
+{
+    openCacheIndex(&cache->index, path);
+}
+/**
+ * @brief Find the result of a log file in the loaded index file of the cache by binary search.
+ * @param[in] cache The cache.
+ * @param[in] path The absolute path to the log file.
+ * @param[out] entry The entry, whose path points into the index file.
+ * @return Return 1 on success, or 0 if there is none.
+ * @note It can be called by several threads at once as long as the cache isn't saved.
+ */
+int findCacheEntry(const Cache *cache, const char *path, CacheEntry *entry)
+{
+    const CacheIndex *index = &cache->index;
+    size_t low = 0, high = index->count;
+    while (low < high)
+    {
+        size_t middle = low + (high - low) / 2;
+        const char *key = getRecordPath(index, &index->records[middle]);
+        int order = key != NULL ? strcmp(key, path) : -1;
+        if (order == 0)
+            return readCacheRecord(index, &index->records[middle], entry) == 0;
+        if (order < 0)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return 0;
+}
+/**
+ * @brief Record the result of parsing a log file in the cache.
+ * @param[in,out] cache The cache.
+ * @param[in] path The absolute path to the log file.
+ * @param[in] stamp The version of the file that has been parsed.
+ * @param[in] summary The result of parsing.
+ */
+void updateCache(Cache *cache, const char *path, const McFileStamp *stamp, const McSummary *summary)
+{
+    CacheEntry new = {strdup(path), *stamp, *summary};
+    if (new.path == NULL)
+        return;
+    if (appendCacheEntry(cache, &new) != 0)
+        free(new.path);
+    else
+        cache->dirty = 1;
+}
+/**
+ * @brief Take the next entry in path order from the records of an index file and the sorted new entries of the cache.
+ * @param[in] index The index file.
+ * @param[in] cache The cache, whose new entries are sorted.
+ * @param[in,out] record The number of records taken so far.
+ * @param[in,out] next The number of new entries taken so far.
+ * @param[out] entry The entry.
+ * @return Return 1 on success, or 0 if both are exhausted.
+ * @note A new entry replaces a record with the same path, and the newest of several new entries with the same path
+ * replaces the others. Malformed records are dropped.
+ */
+int mergeCacheEntry(const CacheIndex *index, const Cache *cache, size_t *record, size_t *next, CacheEntry *entry)
+{
+    CacheEntry old;
+    while (*record < index->count && readCacheRecord(index, &index->records[*record], &old) != 0)
+        (*record)++;
+    while (*next + 1 < cache->count && strcmp(cache->entries[*next].path, cache->entries[*next + 1].path) == 0)
+        (*next)++;
+    if (*record == index->count && *next == cache->count)
+        return 0;
+    int order = *record == index->count ? 1 : *next == cache->count ? -1 : strcmp(old.path, cache->entries[*next].path);
+    if (order < 0)
+    {
+        *entry = old;
+        (*record)++;
+        return 1;
+    }
+    *entry = cache->entries[(*next)++];
+    *record += order == 0;
+    return 1;
+}
+/**
+ * @brief Lock a cache index file against other runs saving it at the same time.
+ * @param[in] path The path to the lock file of the index file.
+ * @return Return the descriptor holding the lock, which is released by closing it, or -1 on failure.
+ * @note The lock is taken on a file of its own, since the index file is replaced by every save and a run waiting for
+ * a lock on it would get the replaced file.
+ */
+int lockCacheIndex(const char *path)
+{
+    int fd = open(path, O_RDWR | O_CREAT | O_BINARY, 0644);
+    if (fd == -1)
+        return -1;
+#ifdef _WIN32
+    OVERLAPPED overlapped = {0};
+    if (!LockFileEx((HANDLE)_get_osfhandle(fd), LOCKFILE_EXCLUSIVE_LOCK, 0, 1, 0, &overlapped))
+#else
+    struct flock lock = {.l_type = F_WRLCK, .l_whence = SEEK_SET};
+    int ret;
+    while ((ret = fcntl(fd, F_SETLKW, &lock)) != 0 && errno == EINTR)
+        ;
+    if (ret != 0)
+#endif
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+/**
+ * @brief Save the cache to an index file if it has been modified, and load the saved index file.
+ * @param[in,out] cache The cache.
+ * @param[in] path The path to the index file.
+ * @return Return 0 on success, or -1 on failure.
+ * @note The new entries are merged with the index file as it is on disk now, under a lock that other runs saving it
+ * wait for, so that the results they save are kept. The index is written and synced to a temporary file which then
+ * replaces the old one, so it is never left half written. Where the file system doesn't support locks, the index is
+ * saved without one.
+ */
+int saveCache(Cache *cache, const char *path)
+{
+    if (!cache->dirty)
+        return 0;
+    qsort(cache->entries, cache->count, sizeof(CacheEntry), compareCacheEntry);
+    char *tmp = malloc(strlen(path) + 32);
+    if (tmp == NULL)
+        return -1;
+    makeParentDirectories(path);
+    sprintf(tmp, "%s.lock", path);
+    int lock = lockCacheIndex(tmp);
+    sprintf(tmp, "%s.%ld.tmp", path, (long)getpid());
+    FILE *file = fopen(tmp, "wb");
+    if (file == NULL)
+    {
+        if (lock != -1)
+            close(lock);
+        free(tmp);
+        return -1;
+    }
+    CacheIndex current;
+    openCacheIndex(&current, path);
+    CacheHeader header = {CACHE_MAGIC, CACHE_VERSION, sizeof(CacheRecord), getCacheSignature(), 0, 0};
+    CacheEntry entry;
+    fwrite(&header, sizeof(CacheHeader), 1, file);
+    // The records are written first, so the paths are written in a second pass over the same entries.
+    for (size_t record = 0, next = 0; mergeCacheEntry(&current, cache, &record, &next, &entry);)
+    {
+        const McSummary *summary = &entry.summary;
+        CacheRecord out = {.path = header.poolSize, .inode = entry.stamp.inode, .size = entry.stamp.size,
+                           .mtime = entry.stamp.mtime, .start = summary->start, .end = summary->end,
+                           .time = summary->time, .bytes = summary->bytes, .days = summary->days,
+                           .sessions = summary->sessions, .active = summary->active, .length = strlen(entry.path)};
+        for (int i = 0; i < MC_HISTOGRAM_DAYS; i++)
+            out.histogramDays[i] = summary->histogram.days[i];
+        for (int i = 0; i < 24; i++)
+            out.histogramHours[i] = summary->histogram.hours[i];
+        fwrite(&out, sizeof(CacheRecord), 1, file);
+        header.count++, header.poolSize += out.length + 1;
+    }
+    for (size_t record = 0, next = 0; mergeCacheEntry(&current, cache, &record, &next, &entry);)
+        fwrite(entry.path, 1, strlen(entry.path) + 1, file);
+    closeCacheIndex(&current);
+    rewind(file);
+    fwrite(&header, sizeof(CacheHeader), 1, file);
+    // Without a sync, a crash after the rename could leave the index file without its data.
+    int ret = ferror(file) | fflush(file);
+#ifdef _WIN32
+    ret |= _commit(_fileno(file));
+#else
+    ret |= fsync(fileno(file));
+#endif
+    ret |= fclose(file);
+#ifdef _WIN32
+    if (ret == 0)
+    {
+        closeCacheIndex(&cache->index);
+        remove(path);
+    }
+#endif
+    if (ret != 0 || rename(tmp, path) != 0)
+    {
+        remove(tmp);
+        ret = -1;
+    }
+    else
+    {
+        // The saved index file holds the new entries from now on.
+        closeCacheIndex(&cache->index);
+        openCacheIndex(&cache->index, path);
+        for (size_t i = 0; i < cache->count; i++)
+            free(cache->entries[i].path);
+        cache->count = 0;
+        cache->dirty = 0;
+    }
+    if (lock != -1)
+        close(lock);
+    free(tmp);
+    return ret;
+}
+/**
+ * @brief Free the entries of the cache and close its index file.
+ * @param[in,out] cache The cache.
+ */
+void freeCache(Cache *cache)
+{
+    for (size_t i = 0; i < cache->count; i++)
+        free(cache->entries[i].path);
+    free(cache->entries);
+    cache->entries = NULL;
+    cache->count = cache->capacity = 0;
+    closeCacheIndex(&cache->index);
+}
+/** The size of the compressed logs for which an access point index is built. */
+#define INDEX_THRESHOLD (64 * 1024 * 1024)
+/** The directory of the access point index files, or NULL if they aren't used. */
+char *indexDir = NULL;
+/**
+ * @brief Get the path to the access point index file of a log file.
+ * @param[in] key The absolute path to the log file.
+ * @return Return the path, which should be freed, or NULL on failure.
+ */
+char *getIndexPath(const char *key)
+{
+    char *path = malloc(strlen(indexDir) + 32);
+    if (path != NULL)
+        sprintf(path, "%s/%016llx.idx", indexDir, hashText(HASH_BASIS, key));
+    return path;
+}
+/**
+ * @brief The result of parsing a log file.
+ */
+typedef struct
+{
+    char *path;                 /**< The path to the log file. */
+    char *key;                  /**< The absolute path to the log file if its result can be cached, or NULL. */
+    McFileStamp stamp;          /**< The version of the file if its result can be cached. */
+    McSummary summary;          /**< The times recorded by the log file. */
+    int status;                 /**< The return value of `mcParseFile()`. */
+    int cached;                 /**< Whether the result comes from the cache. */
+    unsigned char *data;        /**< The content of the file if it has been prefetched, or NULL. */
+    size_t size;                /**< The size of the prefetched content. */
+    unsigned long long device;  /**< The device of the file if it has been stated while listing. */
+    int stated;                 /**< Whether `stamp` has been filled in, and `device` if while listing. */
+    time_t estimate;            /**< The playtime counted for the file in the provisional total of `--lazy`. */
+} FileResult;
+/**
+ * @brief Fill in the stamp of a log file unless it has already been stated.
+ * @param[in,out] result The log file.
+ * @return Return 0 on success, or -1 on failure.
+ */
+int statResult(FileResult *result)
+{
+    if (result->stated)
+        return 0;
+    STATS_CLOCK(clock);
+    STATS_START(clock);
+    struct stat status;
+    int ret = stat(result->path, &status);
+    STATS_STOP(clock, MC_PHASE_OPEN);
+    if (ret != 0)
+        return -1;
+    result->stamp.inode = status.st_ino;
+    result->stamp.size = status.st_size;
+    result->stamp.mtime = status.st_mtime;
+    result->stated = 1;
+    return 0;
+}
+/**
+ * @brief Look up the result of a log file in the cache.
+ * @param[in,out] result The log file. Its stamp is filled in, and its summary and status if it is done.
+ * @return Return 1 if the result is done, or 0 if the file has to be parsed.
  */
-int parseFile(const char *path, time_t *time)
+int lookupResult(FileResult *result)
 {
-    gzFile gf = gzopen(path, "r");
-    if (gf == NULL)
+    result->cached = 0;
+    if (result->key == NULL)
+        return 0;
+    if (statResult(result) != 0)
+    {
+        result->status = 1;
+        return 1;
+    }
+    CacheEntry entry;
+    if (findCacheEntry(&resultCache, result->key, &entry) &&
+        memcmp(&entry.stamp, &result->stamp, sizeof(McFileStamp)) == 0)
+    {
+        result->summary = entry.summary;
+        result->status = 0;
+        result->cached = 1;
+        STATS_ADD(cachedFiles, 1);
         return 1;
-    time_t start, end, tmp;
-    while (parseLine(gf, &start) == 1)
-        if (gzeof(gf) == 1)
-            return 2;
-    end = start;
-    while (gzeof(gf) == 0)
-        if (parseLine(gf, &tmp) == 0)
-            end = tmp;
-    gzclose(gf);
-    *time = end - start;
-    printf("%s: %d\n", path, *time);
+    }
     return 0;
 }
 /**
- * @brief Determine whether it is a minecraft `.log.gz` file by name.
- * @param[in] name The name of the file.
+ * @brief Determine whether a log file that isn't in the cache is parsed through an access point index.
+ * @param[in] result The log file, whose stamp has been filled in by `lookupResult()`.
  * @return Return 1 on success, or 0 on failure.
  */
-int isLogGzFile(const char *name)
+int mayBeIndexed(const FileResult *result)
 {
-    const char *format = "nnnn-nn-nn-n.log.gz";
-    int i = 0;
+    return result->key != NULL && indexDir != NULL && result->stamp.size >= INDEX_THRESHOLD;
+}
+/**
+ * @brief Get the parser of the current thread.
+ * @return Return the parser, or NULL on failure.
+ */
+McParser *getParser()
+{
+    if (threadParser == NULL)
+        threadParser = mcCreateParser(&options);
+    return threadParser;
+}
+/**
+ * @brief Free the parser of the current thread. Its statistics have to be merged before.
+ */
+void releaseParser()
+{
+    mcFreeParser(threadParser);
+    threadParser = NULL;
+}
+/**
+ * @brief Parse a log file that isn't in the cache, from its prefetched content if there is one.
+ * @param[in,out] result The log file. Its summary and status are filled in.
+ */
+void parsePending(FileResult *result)
+{
+    McParser *parser = getParser();
+    char *indexPath;
+    if (parser == NULL)
+    {
+        result->status = 1;
+        return;
+    }
+    if (mayBeIndexed(result) && (indexPath = getIndexPath(result->key)) != NULL)
+    {
+        makeParentDirectories(indexPath);
+        int ret = mcParseIndexed(parser, result->path, indexPath, &result->summary);
+        free(indexPath);
+        if (ret != -1)
+        {
+            result->status = ret;
+            return;
+        }
+    }
+    result->status = result->data != NULL ? mcParseBuffer(parser, result->data, result->size, &result->summary)
+                                          : mcParseFile(parser, result->path, &result->summary);
+}
+/** Whether the workers refine the provisional total of `--lazy` as they finish log files. */
+int refining = 0;
+/** The provisional total time of `--lazy`. */
+atomic_llong provisionalTime = 0;
+/** The number of log files in the provisional total of `--lazy` that are still estimated. */
+atomic_size_t provisionalPending = 0;
+/**
+ * @brief Count a finished log file in the provisional total of `--lazy` with its result instead of its estimate.
+ * @param[in] result The log file.
+ */
+void refineProvisional(const FileResult *result)
+{
+    if (!refining)
+        return;
+    atomic_fetch_add(&provisionalTime, (long long)(result->status == 0 ? result->summary.time : 0) - result->estimate);
+    atomic_fetch_sub(&provisionalPending, 1);
+}
+/**
+ * @brief Parse a log file unless its result is in the cache.
+ * @param[in,out] result The log file to parse. Its summary, status and stamp are filled in.
+ */
+void parseResult(FileResult *result)
+{
+    STATS_CLOCK(file);
+    STATS_START(file);
+    if (!lookupResult(result))
+        parsePending(result);
+    refineProvisional(result);
+    STATS_ADD(files, 1);
+    STATS_FILE(file, result->path);
+}
+/**
+ * @brief The state shared by the workers parsing a list of log files.
+ */
+typedef struct
+{
+    FileResult *results;  /**< The log files to parse. */
+    size_t count;         /**< The number of log files. */
+    atomic_size_t next;   /**< The index of the next log file to parse. */
+} ParseQueue;
+/** The number of threads of the thread budget still held by the workers parsing a list of log files. */
+atomic_int workerThreads = 0;
+/**
+ * @brief Give the thread of a worker back to the thread budget once it has run out of log files, so that the chunks
+ * of the indexed files still being parsed can use it.
+ */
+void returnWorkerThread()
+{
+    int held = atomic_load(&workerThreads);
+    while (held > 0 && !atomic_compare_exchange_weak(&workerThreads, &held, held - 1))
+        ;
+    if (held > 0)
+        mcReturnThreads(options.threads, 1);
+}
+/**
+ * @brief Parse log files from a queue until it is exhausted.
+ * @param[in,out] arg A `ParseQueue` pointer.
+ * @return Return NULL.
+ */
+void *parseWorker(void *arg)
+{
+    ParseQueue *queue = arg;
+    size_t i;
+    while ((i = atomic_fetch_add(&queue->next, 1)) < queue->count)
+        parseResult(&queue->results[i]);
+    returnWorkerThread();
+    STATS_MERGE();
+    releaseParser();
+    return NULL;
+}
+/** Whether log files are read ahead of the workers by a separate thread. */
+int prefetch = 0;
+/** The most bytes of log files that are read ahead of the workers at once, or 0 for no limit. */
+size_t prefetchBudget = 0;
+/** The number of log files that can be read ahead of the workers. It must be a power of 2. */
+#define PREFETCH_QUEUE_SIZE 32
+/** The number of reads in flight at once while prefetching. */
+#define PREFETCH_READS 8
+/** The size of the largest log file that is read into memory while prefetching. */
+#define PREFETCH_LIMIT (4 * 1024 * 1024)
+/**
+ * @brief A slot of a `PrefetchQueue`.
+ */
+typedef struct
+{
+    atomic_size_t sequence;  /**< The position that the slot can be pushed at, or that plus 1 if it can be popped. */
+    size_t value;            /**< The index of the log file in the slot. */
+} PrefetchCell;
+/**
+ * @brief A bounded lock-free queue of the log files that are ready to be parsed, after Dmitry Vyukov's MPMC queue.
+ */
+typedef struct
+{
+    PrefetchCell cells[PREFETCH_QUEUE_SIZE];  /**< The slots. */
+    atomic_size_t head;                       /**< The position of the next log file to be popped. */
+    atomic_size_t tail;                       /**< The position of the next log file to be pushed. */
+    atomic_int closed;                        /**< Whether no more log files will be pushed. */
+    FileResult *results;                      /**< The log files. */
+    size_t count;                             /**< The number of log files. */
+    size_t budget;                            /**< The most bytes of log files held in memory, or 0 for no limit. */
+    atomic_size_t buffered;                   /**< The bytes of log files read or being read and not yet parsed. */
+    size_t peak;                              /**< The largest value of `buffered` seen by the reading thread. */
+} PrefetchQueue;
+/**
+ * @brief A read of a log file into memory that may still be in flight.
+ */
+typedef struct
+{
+    FileResult *result;         /**< The log file being read. */
+    int fd;                     /**< The log file. */
+    size_t size;                /**< The size of the log file. */
+#ifdef USE_AIO
+    struct aiocb control;       /**< The asynchronous read. */
+#endif
+} PrefetchRead;
+/**
+ * @brief Wait a little for another thread to make progress.
+ * @param[in,out] spins The number of times it has been waited for in a row, or 0 for the first time.
+ */
+void backOff(int *spins)
+{
+    if ((*spins)++ < 16)
+    {
+        sched_yield();
+        return;
+    }
+#ifdef _WIN32
+    Sleep(1);
+#else
+    struct timespec pause = {0, 1000000};
+    nanosleep(&pause, NULL);
+#endif
+}
+/**
+ * @brief Push a log file to a prefetch queue, waiting while it is full.
+ * @param[in,out] queue The queue.
+ * @param[in] value The index of the log file.
+ */
+void pushPrefetch(PrefetchQueue *queue, size_t value)
+{
+    int spins = 0;
+    size_t position = atomic_load_explicit(&queue->tail, memory_order_relaxed);
     for (;;)
     {
-        if (format[i] == 'n')
+        PrefetchCell *cell = &queue->cells[position & (PREFETCH_QUEUE_SIZE - 1)];
+        size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)position;
+        if (diff == 0)
         {
-            if (!isdigit(name[i]))
-                return 0;
+            if (atomic_compare_exchange_weak_explicit(&queue->tail, &position, position + 1, memory_order_relaxed,
+                                                      memory_order_relaxed))
+            {
+                cell->value = value;
+                atomic_store_explicit(&cell->sequence, position + 1, memory_order_release);
+                return;
+            }
         }
+        else if (diff < 0)
+        {
+            // The queue is full until a worker pops the log file in this slot.
+            backOff(&spins);
+            position = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+        }
+        else
+            position = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    }
+}
+/**
+ * @brief Pop a log file from a prefetch queue without waiting.
+ * @param[in,out] queue The queue.
+ * @param[out] value The index of the log file.
+ * @return Return 0 on success, or -1 if the queue is empty.
+ */
+int popPrefetch(PrefetchQueue *queue, size_t *value)
+{
+    size_t position = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    for (;;)
+    {
+        PrefetchCell *cell = &queue->cells[position & (PREFETCH_QUEUE_SIZE - 1)];
+        size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)(position + 1);
+        if (diff == 0)
+        {
+            if (atomic_compare_exchange_weak_explicit(&queue->head, &position, position + 1, memory_order_relaxed,
+                                                      memory_order_relaxed))
+            {
+                *value = cell->value;
+                atomic_store_explicit(&cell->sequence, position + PREFETCH_QUEUE_SIZE, memory_order_release);
+                return 0;
+            }
+        }
+        else if (diff < 0)
+            return -1;
+        else
+            position = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    }
+}
+/**
+ * @brief Free the content of a log file read into memory and give its bytes back to the budget.
+ * @param[in,out] queue The queue.
+ * @param[in,out] result The log file.
+ */
+void releasePrefetch(PrefetchQueue *queue, FileResult *result)
+{
+    if (result->data == NULL)
+        return;
+    free(result->data);
+    result->data = NULL;
+    atomic_fetch_sub(&queue->buffered, result->size);
+}
+/**
+ * @brief Open a log file to be read into memory unless it is in the cache or is better read by its parser.
+ * @param[in,out] queue The queue whose budget the read will be taken from.
+ * @param[out] read The read, whose file is opened and whose size is filled in.
+ * @param[in,out] result The log file.
+ * @return Return 0 if it is to be read, 1 if the log file has to be parsed without waiting, or -1 if its result is
+ * done.
+ * @note A log file larger than the whole budget is left to its parser, which streams it.
+ */
+int openPrefetch(PrefetchQueue *queue, PrefetchRead *read, FileResult *result)
+{
+    STATS_CLOCK(clock);
+    if (lookupResult(result))
+    {
+        refineProvisional(result);
+        STATS_ADD(files, 1);
+        return -1;
+    }
+    if (mayBeIndexed(result))
+        return 1;
+    STATS_START(clock);
+    struct stat status;
+    if ((read->fd = open(result->path, O_RDONLY | O_BINARY)) == -1)
+        return 1;
+    if (fstat(read->fd, &status) != 0 || status.st_size == 0 || status.st_size > PREFETCH_LIMIT ||
+        (queue->budget > 0 && (size_t)status.st_size > queue->budget))
+    {
+        close(read->fd);
+        STATS_STOP(clock, MC_PHASE_OPEN);
+        return 1;
+    }
+    read->result = result;
+    read->size = status.st_size;
+    STATS_STOP(clock, MC_PHASE_OPEN);
+    return 0;
+}
+/**
+ * @brief Start reading a log file opened by `openPrefetch()` into memory.
+ * @param[in,out] queue The queue whose budget the read is taken from.
+ * @param[in,out] read The read.
+ * @return Return 0 if the read is in flight, 1 if the log file has to be parsed without waiting, or 2 if it has to
+ * be started again once the log files in memory have been parsed, with the file left open.
+ */
+int startPrefetch(PrefetchQueue *queue, PrefetchRead *read)
+{
+    FileResult *result = read->result;
+    size_t buffered = atomic_load(&queue->buffered);
+    if (queue->budget > 0 && buffered > queue->budget - read->size)
+        return 2;
+    STATS_CLOCK(clock);
+    STATS_START(clock);
+    if ((result->data = malloc(read->size)) == NULL)
+    {
+        close(read->fd);
+        STATS_STOP(clock, MC_PHASE_OPEN);
+        return 1;
+    }
+    result->size = read->size;
+    buffered = atomic_fetch_add(&queue->buffered, result->size) + result->size;
+    if (buffered > queue->peak)
+        queue->peak = buffered;
+    STATS_STOP(clock, MC_PHASE_OPEN);
+#ifdef USE_AIO
+    memset(&read->control, 0, sizeof(struct aiocb));
+    read->control.aio_fildes = read->fd;
+    read->control.aio_buf = result->data;
+    read->control.aio_nbytes = result->size;
+    if (aio_read(&read->control) == 0)
+        return 0;
+#endif
+    // Without asynchronous reads, the reading thread still stays ahead of the workers.
+    STATS_START(clock);
+    size_t done = 0;
+    ssize_t got;
+    while (done < result->size && (got = pread(read->fd, result->data + done, result->size - done, done)) > 0)
+        done += got;
+    close(read->fd);
+    STATS_STOP(clock, MC_PHASE_INFLATE);
+    if (done != result->size)
+        releasePrefetch(queue, result);
+    return 1;
+}
+#ifdef USE_AIO
+/**
+ * @brief Finish a read of a log file into memory if it is no longer in flight.
+ * @param[in,out] queue The queue whose budget the read has been taken from.
+ * @param[in,out] read The read.
+ * @return Return 1 if it is finished, or 0 if it is still in flight.
+ */
+int finishPrefetch(PrefetchQueue *queue, PrefetchRead *read)
+{
+    if (aio_error(&read->control) == EINPROGRESS)
+        return 0;
+    FileResult *result = read->result;
+    // A failed or short read leaves the log file to be read again by its parser.
+    if (aio_return(&read->control) != (ssize_t)result->size)
+        releasePrefetch(queue, result);
+    close(read->fd);
+    return 1;
+}
+#endif
+/**
+ * @brief Read log files into memory in order and push them to a prefetch queue.
+ * @param[in,out] arg A `PrefetchQueue` pointer.
+ * @return Return NULL.
+ */
+void *prefetchReader(void *arg)
+{
+    PrefetchQueue *queue = arg;
+    PrefetchRead reads[PREFETCH_READS];
+    // An `aiocb` must stay where it is while its read is in flight, so only the slot numbers are moved around. The
+    // first `active` slots are in flight.
+    size_t slots[PREFETCH_READS], next = 0, active = 0;
+    // A log file that doesn't fit into the budget yet is kept open until it does.
+    PrefetchRead held;
+    int spins = 0, holding = 0;
+    for (size_t i = 0; i < PREFETCH_READS; i++)
+        slots[i] = i;
+    while (next < queue->count || active > 0)
+    {
+        while (next < queue->count && active < PREFETCH_READS)
+        {
+            FileResult *result = &queue->results[next];
+            PrefetchRead *read = &reads[slots[active]];
+            int ret = holding ? 0 : openPrefetch(queue, read, result);
+            if (holding)
+                *read = held, holding = 0;
+            if (ret == 0 && (ret = startPrefetch(queue, read)) == 2)
+            {
+                // The budget is used up, so the reads in flight are finished or the workers are waited for.
+                held = *read, holding = 1;
+                if (active == 0)
+                    backOff(&spins);
+                break;
+            }
+            next++, spins = 0;
+            if (ret == 0)
+                active++;
+            else if (ret == 1)
+                pushPrefetch(queue, result - queue->results);
+        }
+#ifdef USE_AIO
+        if (active == 0)
+            continue;
+        const struct aiocb *list[PREFETCH_READS];
+        for (size_t i = 0; i < active; i++)
+            list[i] = &reads[slots[i]].control;
+        STATS_CLOCK(clock);
+        STATS_START(clock);
+        aio_suspend(list, active, NULL);
+        STATS_STOP(clock, MC_PHASE_INFLATE);
+        for (size_t i = 0; i < active; i++)
+            if (finishPrefetch(queue, &reads[slots[i]]))
+            {
+                size_t slot = slots[i];
+                pushPrefetch(queue, reads[slot].result - queue->results);
+                slots[i--] = slots[--active];
+                slots[active] = slot;
+            }
+#endif
+    }
+    atomic_store(&queue->closed, 1);
+    STATS_PEAK(peakPrefetchBytes, (long long)queue->peak);
+    STATS_MERGE();
+    return NULL;
+}
+/**
+ * @brief Parse log files from a prefetch queue until it is closed and empty.
+ * @param[in,out] arg A `PrefetchQueue` pointer.
+ * @return Return NULL.
+ */
+void *prefetchWorker(void *arg)
+{
+    PrefetchQueue *queue = arg;
+    size_t i;
+    int spins = 0;
+    for (;;)
+    {
+        if (popPrefetch(queue, &i) != 0)
+        {
+            if (!atomic_load(&queue->closed))
+            {
+                backOff(&spins);
+                continue;
+            }
+            // The last log files may have been pushed between the failed pop and the closing.
+            if (popPrefetch(queue, &i) != 0)
+                break;
+        }
+        spins = 0;
+        FileResult *result = &queue->results[i];
+        STATS_CLOCK(file);
+        STATS_START(file);
+        parsePending(result);
+        releasePrefetch(queue, result);
+        refineProvisional(result);
+        STATS_ADD(files, 1);
+        STATS_FILE(file, result->path);
+    }
+    returnWorkerThread();
+    STATS_MERGE();
+    releaseParser();
+    return NULL;
+}
+/**
+ * @brief Parse a list of log files with up to `jobs` threads.
+ * @param[in,out] results The log files to parse. The result of each one is filled in.
+ * @param[in] count The number of log files.
+ */
+void parseFiles(FileResult *results, size_t count)
+{
+    ParseQueue queue = {results, count, 0};
+    PrefetchQueue *prefetchQueue = NULL;
+    pthread_t reader;
+    void *(*worker)(void *) = parseWorker;
+    void *arg = &queue;
+    if (prefetch && count > 1 && (prefetchQueue = calloc(1, sizeof(PrefetchQueue))) != NULL)
+    {
+        for (size_t i = 0; i < PREFETCH_QUEUE_SIZE; i++)
+            atomic_init(&prefetchQueue->cells[i].sequence, i);
+        prefetchQueue->results = results;
+        prefetchQueue->count = count;
+        prefetchQueue->budget = prefetchBudget;
+        if (pthread_create(&reader, NULL, prefetchReader, prefetchQueue) == 0)
+            worker = prefetchWorker, arg = prefetchQueue;
+        else
+            free(prefetchQueue), prefetchQueue = NULL;
+    }
+    size_t threads = (size_t)options.jobs < count ? (size_t)options.jobs : count, created = 0;
+    pthread_t *thread = threads > 1 ? malloc((threads - 1) * sizeof(pthread_t)) : NULL;
+    // Every worker holds a thread of the budget, which the chunks of indexed files only get once it is given back.
+    if (options.threads != NULL)
+        atomic_store(&workerThreads, mcTakeThreads(options.threads, (int)threads));
+    if (thread != NULL)
+        while (created < threads - 1 && pthread_create(&thread[created], NULL, worker, arg) == 0)
+            created++;
+    for (size_t i = created + 1; i < threads; i++)
+        returnWorkerThread();
+    worker(arg);
+    for (size_t i = 0; i < created; i++)
+        pthread_join(thread[i], NULL);
+    free(thread);
+    if (prefetchQueue != NULL)
+    {
+        pthread_join(reader, NULL);
+        free(prefetchQueue);
+    }
+}
+/**
+ * @brief Compare two log files by path for `qsort()`.
+ */
+int compareFileResult(const void *a, const void *b)
+{
+    return strcmp(((const FileResult *)a)->path, ((const FileResult *)b)->path);
+}
+/**
+ * @brief Determine whether it is a minecraft `.log.gz` file by name.
+ * @param[in] name The name of the file.
+ * @return Return 1 on success, or 0 on failure.
+ */
+int isLogGzFile(const char *name)
+{
+    const char *format = "nnnn-nn-nn-n.log.gz";
+    int i = 0;
+    for (;;)
+    {
+        if (format[i] == 'n')
+        {
+            if (!isdigit(name[i]))
+                return 0;
+        }
+        else
+        {
+            if (name[i] != format[i])
+                return 0;
+            if (format[i] == '\0')
+                return 1;
+        }
+        i++;
+    }
+}
+/** The size of the blocks that an arena allocates from. */
+#define ARENA_BLOCK_SIZE (64 * 1024)
+/**
+ * @brief A block of memory of an arena.
+ */
+typedef struct ArenaBlock
+{
+    struct ArenaBlock *next;  /**< The block allocated before this one, or NULL. */
+    size_t used;              /**< The number of bytes of `data` that are allocated. */
+    size_t size;              /**< The size of `data`. */
+    max_align_t data[];       /**< The memory. */
+} ArenaBlock;
+/**
+ * @brief A bump allocator whose allocations are all freed at once.
+ */
+typedef struct
+{
+    ArenaBlock *head;  /**< The block that is allocated from, or NULL. */
+} Arena;
+/**
+ * @brief Allocate memory from an arena.
+ * @param[in,out] arena The arena.
+ * @param[in] size The number of bytes.
+ * @return Return the memory aligned for any type, or NULL on failure.
+ */
+void *allocArena(Arena *arena, size_t size)
+{
+    size = (size + sizeof(max_align_t) - 1) / sizeof(max_align_t) * sizeof(max_align_t);
+    ArenaBlock *block = arena->head;
+    if (block == NULL || block->size - block->used < size)
+    {
+        size_t capacity = size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE;
+        if ((block = malloc(sizeof(ArenaBlock) + capacity)) == NULL)
+            return NULL;
+        block->used = 0;
+        block->size = capacity;
+        // A block of one large allocation goes behind the current one, which may still have room for small ones.
+        if (size > ARENA_BLOCK_SIZE && arena->head != NULL)
+            block->next = arena->head->next, arena->head->next = block;
+        else
+            block->next = arena->head, arena->head = block;
+    }
+    void *memory = (char *)block->data + block->used;
+    block->used += size;
+    return memory;
+}
+/**
+ * @brief Free all memory allocated from an arena.
+ * @param[in,out] arena The arena, which is empty afterwards.
+ */
+void freeArena(Arena *arena)
+{
+    while (arena->head != NULL)
+    {
+        ArenaBlock *next = arena->head->next;
+        free(arena->head);
+        arena->head = next;
+    }
+}
+/**
+ * @brief Copy a string into an arena.
+ * @param[in,out] arena The arena.
+ * @param[in] text The string.
+ * @return Return the copy, or NULL on failure.
+ */
+char *copyString(Arena *arena, const char *text)
+{
+    size_t size = strlen(text) + 1;
+    char *copy = allocArena(arena, size);
+    if (copy != NULL)
+        memcpy(copy, text, size);
+    return copy;
+}
+/**
+ * @brief A growable list of log files.
+ */
+typedef struct
+{
+    FileResult *results;  /**< The log files. */
+    size_t count;         /**< The number of log files. */
+    size_t capacity;      /**< The number of log files that fit in `results`. */
+    Arena *arena;         /**< The arena that the list and its paths are allocated from. */
+} FileList;
+/**
+ * @brief Join a directory path and a name into a path allocated from an arena.
+ * @param[in,out] arena The arena.
+ * @param[in] dir The path to the directory.
+ * @param[in] name The name of the entry in the directory.
+ * @return Return the joined path, or NULL on failure.
+ */
+char *joinPath(Arena *arena, const char *dir, const char *name)
+{
+    size_t length = strlen(dir);
+    while (length > 1 && (dir[length - 1] == '/' || dir[length - 1] == '\\'))
+        length--;
+    char *path = allocArena(arena, length + strlen(name) + 2);
+    if (path == NULL)
+        return NULL;
+    memcpy(path, dir, length);
+    path[length] = '/';
+    strcpy(path + length + 1, name);
+    return path;
+}
+/**
+ * @brief Get the absolute path without symbolic links of a path.
+ * @param[in,out] arena The arena that the absolute path is allocated from, or NULL to allocate it with `malloc()`.
+ * @param[in] path The path to resolve.
+ * @return Return the absolute path, or NULL on failure.
+ */
+char *resolvePath(Arena *arena, const char *path)
+{
+#ifdef _WIN32
+    char *absolute = _fullpath(NULL, path, 0);
+#else
+    char *absolute = realpath(path, NULL);
+#endif
+    if (absolute == NULL || arena == NULL)
+        return absolute;
+    char *copy = copyString(arena, absolute);
+    free(absolute);
+    return copy;
+}
+/**
+ * @brief Get the name of the last component of a path.
+ * @param[in] path The path.
+ * @return Return a pointer to the name within the path.
+ */
+const char *fileName(const char *path)
+{
+    const char *name = path;
+    for (const char *p = path; *p != '\0'; p++)
+        if (*p == '/' || *p == '\\')
+            name = p + 1;
+    return name;
+}
+/**
+ * @brief Reserve an empty result at the end of a list of log files.
+ * @param[in,out] list The list of log files.
+ * @return Return the result, which is only counted once the caller increments `count`, or NULL on failure.
+ */
+FileResult *reserveResult(FileList *list)
+{
+    if (list->count == list->capacity)
+    {
+        // The old array stays in the arena, which at most doubles the memory of the list.
+        size_t capacity = list->capacity == 0 ? 64 : list->capacity * 2;
+        FileResult *results = allocArena(list->arena, capacity * sizeof(FileResult));
+        if (results == NULL)
+            return NULL;
+        if (list->count > 0)
+            memcpy(results, list->results, list->count * sizeof(FileResult));
+        list->results = results, list->capacity = capacity;
+    }
+    FileResult *result = &list->results[list->count];
+    memset(result, 0, sizeof(FileResult));
+    return result;
+}
+/**
+ * @brief Append a log file to a list.
+ * @param[in,out] list The list of log files.
+ * @param[in] dir The path to the directory containing the log file.
+ * @param[in] absolute The absolute path to the directory if the result of a rotated log file can be cached, or NULL.
+ * @param[in] name The name of the log file.
+ * @return Return 0 on success, or -1 on failure.
+ */
+int addFile(FileList *list, const char *dir, const char *absolute, const char *name)
+{
+    FileResult *result = reserveResult(list);
+    if (result == NULL)
+        return -1;
+    if ((result->path = joinPath(list->arena, dir, name)) == NULL)
+        return -1;
+    if (absolute != NULL && isLogGzFile(name) && (result->key = joinPath(list->arena, absolute, name)) == NULL)
+        return -1;
+    list->count++;
+    return 0;
+}
+/**
+ * @brief The type of a directory entry as far as the listing tells.
+ */
+typedef enum
+{
+    ENTRY_UNKNOWN,   /**< Only known after opening it, e.g. for a symbolic link. */
+    ENTRY_FILE,      /**< A regular file. */
+    ENTRY_DIRECTORY  /**< A directory. */
+} EntryType;
+/**
+ * @brief A listing of a directory that is read one entry at a time.
+ * @note On Windows, `FindFirstFileExW()` is used instead of the `readdir()` of the runtime, which is emulated on top of
+ * it one entry per call and can't fetch the entries in large batches.
+ */
+typedef struct
+{
+#ifdef _WIN32
+    HANDLE find;                /**< The search handle. */
+    WIN32_FIND_DATAW data;      /**< The next entry, which has been found but not read yet. */
+    int more;                   /**< Whether `data` holds an entry. */
+    char buffer[MAX_PATH * 4];  /**< The name of the current entry in the code page of the process. */
+#else
+    DIR *dir;                   /**< The directory stream. */
+#endif
+    const char *name;           /**< The name of the current entry. */
+    EntryType type;             /**< The type of the current entry. */
+} DirListing;
+/**
+ * @brief Open the listing of a directory.
+ * @param[out] listing The listing.
+ * @param[in] path The path to the directory.
+ * @return Return 0 on success, or -1 on failure with `errno` set.
+ */
+int openListing(DirListing *listing, const char *path)
+{
+#ifdef _WIN32
+    int length = MultiByteToWideChar(CP_ACP, 0, path, -1, NULL, 0);
+    wchar_t *pattern = length > 0 ? malloc((length + 2) * sizeof(wchar_t)) : NULL;
+    if (pattern == NULL)
+    {
+        errno = length > 0 ? ENOMEM : EINVAL;
+        return -1;
+    }
+    MultiByteToWideChar(CP_ACP, 0, path, -1, pattern, length);
+    length--;
+    while (length > 0 && (pattern[length - 1] == L'\\' || pattern[length - 1] == L'/'))
+        length--;
+    wcscpy(pattern + length, L"\\*");
+    // The basic information leaves out the short names, and a large fetch lists the entries in fewer calls.
+    listing->find = FindFirstFileExW(pattern, FindExInfoBasic, &listing->data, FindExSearchNameMatch, NULL,
+                                     FIND_FIRST_EX_LARGE_FETCH);
+    free(pattern);
+    if (listing->find == INVALID_HANDLE_VALUE)
+    {
+        DWORD error = GetLastError();
+        errno = error == ERROR_FILE_NOT_FOUND || error == ERROR_PATH_NOT_FOUND ? ENOENT
+                : error == ERROR_DIRECTORY                                      ? ENOTDIR
+                : error == ERROR_NOT_ENOUGH_MEMORY                              ? ENOMEM
+                                                                                : EACCES;
+        return -1;
+    }
+    listing->more = 1;
+    return 0;
+#else
+    return (listing->dir = opendir(path)) != NULL ? 0 : -1;
+#endif
+}
+/**
+ * @brief Read the next entry of a directory listing into its `name` and `type`.
+ * @param[in,out] listing The listing.
+ * @return Return 1 on success, or 0 at the end of the listing.
+ */
+int readListing(DirListing *listing)
+{
+#ifdef _WIN32
+    // Lost characters can't be reported for UTF-8, which loses none.
+    int utf8 = GetACP() == CP_UTF8;
+    while (listing->more)
+    {
+        BOOL lossy = FALSE;
+        int converted = WideCharToMultiByte(CP_ACP, 0, listing->data.cFileName, -1, listing->buffer,
+                                            sizeof(listing->buffer), NULL, utf8 ? NULL : &lossy);
+        DWORD attributes = listing->data.dwFileAttributes;
+        listing->more = FindNextFileW(listing->find, &listing->data);
+        // A name that the code page can't spell can't be opened by the runtime either.
+        if (converted == 0 || lossy)
+            continue;
+        listing->name = listing->buffer;
+        listing->type = attributes & FILE_ATTRIBUTE_REPARSE_POINT ? ENTRY_UNKNOWN
+                        : attributes & FILE_ATTRIBUTE_DIRECTORY   ? ENTRY_DIRECTORY
+                                                                  : ENTRY_FILE;
+        return 1;
+    }
+    return 0;
+#else
+    struct dirent *entry = readdir(listing->dir);
+    if (entry == NULL)
+        return 0;
+    listing->name = entry->d_name;
+#ifdef DT_DIR
+    listing->type = entry->d_type == DT_DIR ? ENTRY_DIRECTORY : entry->d_type == DT_REG ? ENTRY_FILE : ENTRY_UNKNOWN;
+#else
+    listing->type = ENTRY_UNKNOWN;
+#endif
+    return 1;
+#endif
+}
+/**
+ * @brief Close a directory listing.
+ * @param[in] listing The listing.
+ */
+void closeListing(DirListing *listing)
+{
+#ifdef _WIN32
+    FindClose(listing->find);
+#else
+    closedir(listing->dir);
+#endif
+}
+/**
+ * @brief Determine from a directory listing whether its current entry may be a directory.
+ * @param[in] listing The listing.
+ * @return Return 0 if the listing tells that it isn't, or 1 otherwise.
+ * @note Where the file system reports no type, or the entry is a symbolic link, it is only known after opening it.
+ */
+int mayBeDirectory(const DirListing *listing)
+{
+    return listing->type != ENTRY_FILE;
+}
+/**
+ * @brief Determine from a directory listing whether its current entry may be a regular file.
+ * @param[in] listing The listing.
+ * @return Return 0 if the listing tells that it isn't, or 1 otherwise.
+ */
+int mayBeFile(const DirListing *listing)
+{
+    return listing->type != ENTRY_DIRECTORY;
+}
+/** The first date of the log files to parse as a prefix of `yyyy-MM-dd`, or NULL. */
+const char *sinceDate = NULL;
+/** The last date of the log files to parse as a prefix of `yyyy-MM-dd`, or NULL. */
+const char *untilDate = NULL;
+/** The maximum number of profiles that can be given. */
+#define MAX_PROFILES 16
+/** The names of the versions whose logs are parsed in a `.minecraft` directory, or none for all logs. */
+const char *profiles[MAX_PROFILES];
+/** The number of profiles. */
+int profileCount = 0;
+/**
+ * @brief Determine whether a text is a year, a month or a day in the form of `yyyy-MM-dd`.
+ * @param[in] text The text.
+ * @return Return 1 on success, or 0 on failure.
+ */
+int isDatePrefix(const char *text)
+{
+    const char *format = "nnnn-nn-nn";
+    size_t length = strlen(text);
+    if (length != 4 && length != 7 && length != 10)
+        return 0;
+    for (size_t i = 0; i < length; i++)
+        if (format[i] == 'n' ? !isdigit((unsigned char)text[i]) : text[i] != format[i])
+            return 0;
+    return 1;
+}
+/**
+ * @brief Determine whether a date is within `--since` and `--until`.
+ * @param[in] date The date in the form of `yyyy-MM-dd`, which may be followed by other characters.
+ * @return Return 1 on success, or 0 on failure.
+ * @note A shorter bound covers its whole year or month, so `--until 2023-05` ends on the last day of May.
+ */
+int isDateInRange(const char *date)
+{
+    return (sinceDate == NULL || strncmp(date, sinceDate, strlen(sinceDate)) >= 0) &&
+           (untilDate == NULL || strncmp(date, untilDate, strlen(untilDate)) <= 0);
+}
+/**
+ * @brief Get the date of a log file in the form of `yyyy-MM-dd`.
+ * @param[in] path The path to the log file.
+ * @param[out] date A buffer of 16 characters for outputting the date.
+ * @return Return 0 on success, or -1 on failure.
+ * @note A rotated log file is named after its date, while any other log file is dated by its last change.
+ */
+int getLogFileDate(const char *path, char *date)
+{
+    const char *name = fileName(path);
+    if (isLogGzFile(name))
+    {
+        memcpy(date, name, 10);
+        date[10] = '\0';
+        return 0;
+    }
+    struct stat status;
+    if (stat(path, &status) != 0)
+        return -1;
+    time_t mtime = status.st_mtime;
+    struct tm *local = localtime(&mtime);
+    return local != NULL && strftime(date, 16, "%Y-%m-%d", local) != 0 ? 0 : -1;
+}
+/**
+ * @brief Determine by its name whether a log file is within `--since` and `--until`.
+ * @param[in,out] arena The arena that the path to the log file is allocated from.
+ * @param[in] dir The path to the directory containing the log file.
+ * @param[in] name The name of the log file.
+ * @return Return 1 on success, or 0 on failure.
+ * @note A rotated log file is named after its date. The date of `latest.log` is that of its last change, which only
+ * costs a `stat()`.
+ */
+int isLogFileInRange(Arena *arena, const char *dir, const char *name)
+{
+    if (sinceDate == NULL && untilDate == NULL)
+        return 1;
+    if (isLogGzFile(name))
+        return isDateInRange(name);
+    char *path = joinPath(arena, dir, name), date[16];
+    return path == NULL || getLogFileDate(path, date) != 0 || isDateInRange(date);
+}
+/**
+ * @brief Find the log files within a log directory.
+ * @param[in] path The path to the log directory.
+ * @param[in] absolute The absolute path to the log directory if results can be cached, or NULL.
+ * @param[in,out] list The list that the log files are appended to.
+ * @return Return 0 on success, or -1 on failure.
+ */
+int listDirectory(const char *path, const char *absolute, FileList *list)
+{
+    DirListing listing;
+    if (openListing(&listing, path) != 0)
+        return -1;
+    while (readListing(&listing))
+        if ((isLogGzFile(listing.name) || strcmp(listing.name, "latest.log") == 0) && mayBeFile(&listing) &&
+            isLogFileInRange(list->arena, path, listing.name))
+            if (addFile(list, path, absolute, listing.name) != 0)
+                break;
+    closeListing(&listing);
+    return 0;
+}
+/**
+ * @brief Find the log files within each `logs` directory of a `.minecraft` directory.
+ * @param[in] path The path to the `.minecraft` directory.
+ * @param[in] absolute The absolute path to the `.minecraft` directory if results can be cached, or NULL.
+ * @param[in,out] list The list that the log files are appended to.
+ * @return Return 0 on success, or -1 on failure.
+ * @note Only the directories that the listings show are opened, so missing ones cost no failed system calls. The
+ * `logs` directory of a version is opened directly, which costs no more than listing the version when it is missing.
+ * With `--profile`, only the `logs` directories of the given versions are opened.
+ */
+int listDotMinecraftDirectory(const char *path, const char *absolute, FileList *list)
+{
+    char *logs = joinPath(list->arena, path, "logs"), *versions = joinPath(list->arena, path, "versions");
+    char *absoluteLogs = absolute != NULL ? joinPath(list->arena, absolute, "logs") : NULL;
+    char *absoluteVersions = absolute != NULL ? joinPath(list->arena, absolute, "versions") : NULL;
+    DirListing listing;
+    int hasLogs = 0, hasVersions = 0;
+    if (logs == NULL || versions == NULL)
+        return -1;
+    for (int i = 0; i < profileCount; i++)
+    {
+        char *version = joinPath(list->arena, versions, profiles[i]), *versionLogs = NULL;
+        char *absoluteVersion = NULL, *absoluteVersionLogs = NULL;
+        if (absoluteVersions != NULL && (absoluteVersion = joinPath(list->arena, absoluteVersions, profiles[i])) != NULL)
+            absoluteVersionLogs = joinPath(list->arena, absoluteVersion, "logs");
+        if (version != NULL && (versionLogs = joinPath(list->arena, version, "logs")) != NULL)
+            listDirectory(versionLogs, absoluteVersionLogs, list);
+    }
+    if (profileCount > 0 || openListing(&listing, path) != 0)
+        return 0;
+    while (!(hasLogs && hasVersions) && readListing(&listing))
+        if (mayBeDirectory(&listing))
+        {
+            hasLogs |= strcmp(listing.name, "logs") == 0;
+            hasVersions |= strcmp(listing.name, "versions") == 0;
+        }
+    closeListing(&listing);
+    if (hasLogs)
+        listDirectory(logs, absoluteLogs, list);
+    if (!hasVersions || openListing(&listing, versions) != 0)
+        return 0;
+    while (readListing(&listing))
+    {
+        if (strcmp(listing.name, ".") == 0 || strcmp(listing.name, "..") == 0 || !mayBeDirectory(&listing))
+            continue;
+        char *version = joinPath(list->arena, versions, listing.name), *versionLogs = NULL;
+        char *absoluteVersion = NULL, *absoluteVersionLogs = NULL;
+        if (absoluteVersions != NULL &&
+            (absoluteVersion = joinPath(list->arena, absoluteVersions, listing.name)) != NULL)
+            absoluteVersionLogs = joinPath(list->arena, absoluteVersion, "logs");
+        if (version != NULL && (versionLogs = joinPath(list->arena, version, "logs")) != NULL)
+            listDirectory(versionLogs, absoluteVersionLogs, list);
+    }
+    closeListing(&listing);
+    return 0;
+}
+/** The size of the buffer that the output is collected in. */
+#define OUTPUT_BUFFER_SIZE (64 * 1024)
+/**
+ * @brief A format of the output.
+ */
+typedef enum
+{
+    OUTPUT_TEXT,   /**< Human readable lines with totals. */
+    OUTPUT_JSONL,  /**< One JSON object per file. */
+    OUTPUT_CSV     /**< One CSV row per file after a header. */
+} OutputFormat;
+/** The format of the output. */
+OutputFormat outputFormat = OUTPUT_TEXT;
+/** The buffer that the output is collected in. */
+char outputBuffer[OUTPUT_BUFFER_SIZE];
+/** The number of bytes in the output buffer. */
+size_t outputLength = 0;
+/** Whether the CSV header has been written. */
+int csvHeader = 0;
+/**
+ * @brief Write the output buffer to stdout.
+ */
+void flushOutput()
+{
+    fwrite(outputBuffer, 1, outputLength, stdout);
+    fflush(stdout);
+    outputLength = 0;
+}
+/**
+ * @brief Append bytes to the output buffer, which is written out whenever it is full.
+ * @param[in] data The bytes.
+ * @param[in] size The number of bytes.
+ */
+void writeOutput(const char *data, size_t size)
+{
+    while (size > 0)
+    {
+        if (outputLength == OUTPUT_BUFFER_SIZE)
+            flushOutput();
+        size_t n = OUTPUT_BUFFER_SIZE - outputLength < size ? OUTPUT_BUFFER_SIZE - outputLength : size;
+        memcpy(outputBuffer + outputLength, data, n);
+        outputLength += n, data += n, size -= n;
+    }
+}
+/** Let the compiler check the arguments of a function taking a `printf()` format. */
+#if defined(__MINGW32__)
+#define PRINTF_FORMAT(string, first) __attribute__((format(__MINGW_PRINTF_FORMAT, string, first)))
+#elif defined(__GNUC__)
+#define PRINTF_FORMAT(string, first) __attribute__((format(printf, string, first)))
+#else
+#define PRINTF_FORMAT(string, first)
+#endif
+/**
+ * @brief Append formatted text to the output buffer.
+ * @param[in] format The `printf()` format.
+ */
+PRINTF_FORMAT(1, 2) void printOutput(const char *format, ...)
+{
+    char text[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    if (length > 0)
+        writeOutput(text, (size_t)length < sizeof(text) ? (size_t)length : sizeof(text) - 1);
+}
+/**
+ * @brief Append a path to the output buffer, quoted for the output format.
+ * @param[in] path The path.
+ */
+void writePath(const char *path)
+{
+    if (outputFormat == OUTPUT_JSONL)
+    {
+        writeOutput("\"", 1);
+        for (const char *p = path; *p != '\0'; p++)
+            if (*p == '"' || *p == '\\')
+                printOutput("\\%c", *p);
+            else if ((unsigned char)*p < 0x20)
+                printOutput("\\u%04x", (unsigned char)*p);
+            else
+                writeOutput(p, 1);
+        writeOutput("\"", 1);
+    }
+    else if (outputFormat == OUTPUT_CSV && strpbrk(path, ",\"\r\n") != NULL)
+    {
+        writeOutput("\"", 1);
+        for (const char *p = path; *p != '\0'; p++)
+            writeOutput(*p == '"' ? "\"\"" : p, 1 + (*p == '"'));
+        writeOutput("\"", 1);
+    }
+    else
+        writeOutput(path, strlen(path));
+}
+/**
+ * @brief Output the result of a log file.
+ * @param[in] path The path to the log file.
+ * @param[in] summary The result of parsing the log file.
+ * @note `start` and `end` are seconds since midnight of the first day, or since the epoch for formats with a date.
+ */
+void printResult(const char *path, const McSummary *summary)
+{
+    switch (outputFormat)
+    {
+    case OUTPUT_TEXT:
+        writePath(path);
+        printOutput(": %lld\n", (long long)summary->time);
+        break;
+    case OUTPUT_JSONL:
+        writeOutput("{\"path\":", 8);
+        writePath(path);
+        printOutput(",\"start\":%lld,\"end\":%lld,\"duration\":%lld,\"sessions\":%d,\"bytes\":%lld}\n",
+                    (long long)summary->start, (long long)summary->end, (long long)summary->time, summary->sessions,
+                    summary->bytes);
+        break;
+    case OUTPUT_CSV:
+        if (!csvHeader)
+        {
+            printOutput("path,start,end,duration,sessions,bytes\n");
+            csvHeader = 1;
+        }
+        writePath(path);
+        printOutput(",%lld,%lld,%lld,%d,%lld\n", (long long)summary->start, (long long)summary->end,
+                    (long long)summary->time, summary->sessions, summary->bytes);
+    }
+}
+/**
+ * @brief The playtime of a day of a log file.
+ */
+typedef struct
+{
+    long day;     /**< The number of days since 1970-01-01. */
+    time_t time;  /**< The playtime. */
+} DayTime;
+/** Whether the playtime by day and by hour is printed. */
+int showHistogram = 0;
+/** The playtime of each day of the parsed log files, in the order they have been added. */
+DayTime *dayTimes = NULL;
+/** The number of days in `dayTimes`. */
+size_t dayTimeCount = 0;
+/** The capacity of `dayTimes`. */
+size_t dayTimeCapacity = 0;
+/** The playtime within each hour of the day of the parsed log files. */
+time_t hourTimes[24];
+/**
+ * @brief Add the histogram of a parsed log file to that of all log files.
+ * @param[in] path The path to the log file.
+ * @param[in] summary The result of parsing the log file.
+ * @note The first day of a rotated log file is the date in its name, while the last day of any other log file is the
+ * date of its last change.
+ */
+void addHistogram(const char *path, const McSummary *summary)
+{
+    if (!showHistogram)
+        return;
+    const McHistogram *histogram = &summary->histogram;
+    for (int i = 0; i < 24; i++)
+        hourTimes[i] += histogram->hours[i];
+    char date[16];
+    if (getLogFileDate(path, date) != 0)
+        return;
+    long first = (long)mcGetDayNumber(date);
+    if (!isLogGzFile(fileName(path)))
+    {
+        long span = (summary->end + (time_t)summary->days * MC_DAY_SECONDS) / MC_DAY_SECONDS -
+                    summary->start / MC_DAY_SECONDS;
+        first -= span < MC_HISTOGRAM_DAYS ? span : MC_HISTOGRAM_DAYS - 1;
+    }
+    for (int i = 0; i < MC_HISTOGRAM_DAYS; i++)
+    {
+        if (histogram->days[i] == 0)
+            continue;
+        if (dayTimeCount == dayTimeCapacity)
+        {
+            size_t capacity = dayTimeCapacity > 0 ? dayTimeCapacity * 2 : 64;
+            DayTime *tmp = realloc(dayTimes, capacity * sizeof(DayTime));
+            if (tmp == NULL)
+                return;
+            dayTimes = tmp, dayTimeCapacity = capacity;
+        }
+        dayTimes[dayTimeCount++] = (DayTime){first + i, histogram->days[i]};
+    }
+}
+/**
+ * @brief Compare two days of log files by their dates for `qsort()`.
+ */
+int compareDayTime(const void *a, const void *b)
+{
+    long x = ((const DayTime *)a)->day, y = ((const DayTime *)b)->day;
+    return (x > y) - (x < y);
+}
+/**
+ * @brief Output the playtime of each day with playtime and of each hour of the day.
+ */
+void printHistogram()
+{
+    qsort(dayTimes, dayTimeCount, sizeof(DayTime), compareDayTime);
+    if (outputFormat == OUTPUT_TEXT)
+        printOutput("playtime by day:\n");
+    for (size_t i = 0, j; i < dayTimeCount; i = j)
+    {
+        time_t sum = 0;
+        for (j = i; j < dayTimeCount && dayTimes[j].day == dayTimes[i].day; j++)
+            sum += dayTimes[j].time;
+        time_t midnight = (time_t)dayTimes[i].day * MC_DAY_SECONDS;
+        char date[16] = "";
+        struct tm *utc = gmtime(&midnight);
+        if (utc != NULL)
+            strftime(date, sizeof(date), "%Y-%m-%d", utc);
+        if (outputFormat == OUTPUT_JSONL)
+            printOutput("{\"day\":\"%s\",\"duration\":%lld}\n", date, (long long)sum);
+        else
+            printOutput("    %s: %lld = %lldh %lldmin %llds\n", date, (long long)sum, (long long)sum / 60 / 60,
+                        (long long)sum / 60 % 60, (long long)sum % 60);
+    }
+    if (outputFormat == OUTPUT_TEXT)
+        printOutput("playtime by hour:\n");
+    for (int i = 0; i < 24; i++)
+    {
+        long long sum = hourTimes[i];
+        if (outputFormat == OUTPUT_JSONL)
+            printOutput("{\"hour\":%d,\"duration\":%lld}\n", i, sum);
+        else
+            printOutput("    %02d:00: %lld = %lldh %lldmin %llds\n", i, sum, sum / 60 / 60, sum / 60 % 60, sum % 60);
+    }
+}
+/**
+ * @brief A `latest.log` file that is followed as it grows.
+ */
+typedef struct
+{
+    char *path;                /**< The path to the log file. */
+    char *dir;                 /**< The path to the directory containing the log file. */
+    char *absolute;            /**< The absolute path to the directory if results can be cached, or NULL. */
+    int rotated;               /**< Whether new rotated log files in the directory are counted. */
+    char **known;              /**< The sorted names of the rotated log files that have been counted. */
+    size_t knownCount;         /**< The number of known rotated log files. */
+    long long dirMtime;        /**< The modification time of the directory when it was last listed. */
+    unsigned long long inode;  /**< The inode of the log file. */
+    long long offset;          /**< The offset of the first byte that hasn't been parsed. */
+    int skip;                  /**< Whether the bytes up to the next line feed belong to a parsed line. */
+    McSessions engine;         /**< The sessions of the lines parsed so far. */
+    McSummary summary;         /**< The times recorded so far. */
+    char *profile;             /**< The version whose `logs` directory holds the log file, or "" for none. */
+    char date[16];             /**< The date of the last change of the log file in the form of `yyyy-MM-dd`. */
+} Follower;
+/** Whether the `latest.log` files are followed after the scan. */
+int follow = 0;
+/** The followed `latest.log` files. */
+Follower *followers = NULL;
+/** The number of followed `latest.log` files. */
+size_t followerCount = 0;
+/**
+ * @brief The result of a log file that isn't followed, kept in memory to answer queries with `--serve`.
+ */
+typedef struct
+{
+    char *profile;  /**< The version whose `logs` directory holds the log file, or "" for none. */
+    char date[16];  /**< The date of the log file in the form of `yyyy-MM-dd`. */
+    time_t time;    /**< The playtime. */
+} ServedFile;
+/** Whether queries are answered with `--serve`. */
+int serving = 0;
+/** The results of the log files that aren't followed. */
+ServedFile *servedFiles = NULL;
+/** The number of served files. */
+size_t servedCount = 0;
+/** The number of served files that fit in `servedFiles`. */
+size_t servedCapacity = 0;
+/**
+ * @brief Get the version whose `logs` directory holds a log file.
+ * @param[in] path The path to the log file.
+ * @return Return the newly allocated name of the version, which is empty if the path doesn't end with
+ * `versions/<name>/logs/<file>`, or NULL on failure.
+ */
+char *getProfile(const char *path)
+{
+    // The separators before the name of the file, `logs`, the version and `versions` from the end.
+    const char *separator[4] = {NULL, NULL, NULL, NULL};
+    int count = 0;
+    for (const char *p = path + strlen(path); p > path && count < 4;)
+        if (*--p == '/' || *p == '\\')
+            separator[count++] = p;
+    const char *versions = count == 4 ? separator[3] + 1 : path;
+    if (count < 3 || separator[0] - separator[1] != 5 || strncmp(separator[1] + 1, "logs", 4) != 0 ||
+        separator[2] - versions != 8 || strncmp(versions, "versions", 8) != 0)
+        return strdup("");
+    size_t length = separator[1] - separator[2] - 1;
+    char *profile = malloc(length + 1);
+    if (profile != NULL)
+    {
+        memcpy(profile, separator[2] + 1, length);
+        profile[length] = '\0';
+    }
+    return profile;
+}
+/**
+ * @brief Keep the result of a log file that isn't followed for the queries of `--serve`.
+ * @param[in] path The path to the log file.
+ * @param[in] summary The result of parsing the log file.
+ */
+void addServedFile(const char *path, const McSummary *summary)
+{
+    if (!serving)
+        return;
+    if (servedCount == servedCapacity)
+    {
+        size_t capacity = servedCapacity == 0 ? 64 : servedCapacity * 2;
+        ServedFile *tmp = realloc(servedFiles, capacity * sizeof(ServedFile));
+        if (tmp == NULL)
+            return;
+        servedFiles = tmp, servedCapacity = capacity;
+    }
+    ServedFile *file = &servedFiles[servedCount];
+    if ((file->profile = getProfile(path)) == NULL)
+        return;
+    if (getLogFileDate(path, file->date) != 0)
+        file->date[0] = '\0';
+    file->time = summary->time;
+    servedCount++;
+}
+/**
+ * @brief Compare two strings through pointers for `qsort()` and `bsearch()`.
+ */
+int compareString(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+/**
+ * @brief Start following a parsed `latest.log` file.
+ * @param[in] path The path to the log file.
+ * @param[in] summary The result of parsing the log file.
+ * @param[in] rotated The rotated log files in the same directory that have been counted, or NULL if new ones aren't counted.
+ * @param[in] rotatedCount The number of rotated log files.
+ * @return Return 0 on success, or -1 on failure.
+ */
+int addFollower(const char *path, const McSummary *summary, const FileResult *rotated, size_t rotatedCount)
+{
+    struct stat status;
+    if (stat(path, &status) != 0)
+        return -1;
+    Follower *tmp = realloc(followers, (followerCount + 1) * sizeof(Follower));
+    if (tmp == NULL)
+        return -1;
+    followers = tmp;
+    Follower *follower = &followers[followerCount];
+    memset(follower, 0, sizeof(Follower));
+    size_t length = fileName(path) - path;
+    follower->path = strdup(path);
+    follower->dir = length > 0 ? malloc(length) : strdup(".");
+    if (follower->dir != NULL && length > 0)
+    {
+        memcpy(follower->dir, path, length - 1);
+        follower->dir[length - 1] = '\0';
+    }
+    follower->rotated = rotated != NULL;
+    follower->known = rotatedCount > 0 ? malloc(rotatedCount * sizeof(char *)) : NULL;
+    if (follower->path == NULL || follower->dir == NULL || (rotatedCount > 0 && follower->known == NULL))
+    {
+        free(follower->known);
+        free(follower->dir);
+        free(follower->path);
+        return -1;
+    }
+    for (size_t i = 0; i < rotatedCount; i++)
+        if ((follower->known[follower->knownCount] = strdup(fileName(rotated[i].path))) != NULL)
+            follower->knownCount++;
+    qsort(follower->known, follower->knownCount, sizeof(char *), compareString);
+    if (useCache && follower->rotated)
+        follower->absolute = resolvePath(NULL, follower->dir);
+    follower->inode = status.st_ino;
+    if (follower->rotated && stat(follower->dir, &status) == 0)
+        follower->dirMtime = status.st_mtime;
+    if (serving)
+    {
+        follower->profile = getProfile(path);
+        if (getLogFileDate(path, follower->date) != 0)
+            follower->date[0] = '\0';
+    }
+    follower->summary = *summary;
+    mcResumeSessions(&follower->engine, &options, summary);
+    // Start one byte early so that the rest of a line cut by the end of the scan is skipped.
+    follower->offset = summary->bytes > 0 ? summary->bytes - 1 : 0;
+    follower->skip = summary->bytes > 0;
+    followerCount++;
+    return 0;
+}
+/** Whether a provisional total is printed from the cache before the changed log files are parsed. */
+int lazy = 0;
+/**
+ * @brief Print a provisional total time and write out the output right away.
+ * @param[in] sum The provisional total time.
+ * @param[in] pending The number of log files that are still to be parsed.
+ * @param[in] count The number of log files.
+ */
+void printProvisional(time_t sum, size_t pending, size_t count)
+{
+    if (outputFormat == OUTPUT_JSONL)
+        printOutput("{\"provisional\":%lld,\"pending\":%lld,\"files\":%lld}\n", (long long)sum, (long long)pending,
+                    (long long)count);
+    else
+        printOutput("provisional total time: %lld = %lldh %lldmin %llds (%lld of %lld files to parse)\n",
+                    (long long)sum, (long long)sum / 60 / 60, (long long)sum / 60 % 60, (long long)sum % 60,
+                    (long long)pending, (long long)count);
+    flushOutput();
+}
+/**
+ * @brief Compare two log files by modification time, newest first, for `qsort()`.
+ */
+int compareNewest(const void *a, const void *b)
+{
+    long long x = ((const FileResult *)a)->stamp.mtime, y = ((const FileResult *)b)->stamp.mtime;
+    return x != y ? (x < y ? 1 : -1) : compareFileResult(a, b);
+}
+/**
+ * @brief The log files that are parsed in the background while a provisional total is printed.
+ */
+typedef struct
+{
+    FileResult *results;    /**< The log files to parse. */
+    size_t count;           /**< The number of log files. */
+    int finished;           /**< Whether all log files have been parsed. */
+    pthread_mutex_t mutex;  /**< The mutex protecting `finished`. */
+    pthread_cond_t done;    /**< The condition signaled once all log files have been parsed. */
+} LazyParse;
+/**
+ * @brief Parse the log files of a provisional total on the workers.
+ * @param[in,out] arg A `LazyParse` pointer.
+ * @return Return NULL.
+ */
+void *lazyWorker(void *arg)
+{
+    LazyParse *parse = arg;
+    parseFiles(parse->results, parse->count);
+    pthread_mutex_lock(&parse->mutex);
+    parse->finished = 1;
+    pthread_cond_signal(&parse->done);
+    pthread_mutex_unlock(&parse->mutex);
+    return NULL;
+}
+/**
+ * @brief Parse a list of log files after printing a provisional total from the cache, newest files first.
+ * @param[in,out] results The log files, which are sorted by path again at the end.
+ * @param[in] count The number of log files.
+ * @note A file whose cache entry is stale counts with its old result until it is parsed, and one without an entry
+ * with its size at the playtime per byte of the cached files. The workers parse the files in the background and
+ * count each finished one in the total, which is printed again at most once a second.
+ */
+void parseLazily(FileResult *results, size_t count)
+{
+    time_t cachedTime = 0, sum;
+    long long cachedSize = 0, cachedBytes = 0;
+    size_t pending = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        FileResult *result = &results[i], tmp;
+        if (lookupResult(result))
+        {
+            STATS_ADD(files, 1);
+            if (result->cached)
+            {
+                cachedTime += result->summary.time;
+                cachedSize += result->stamp.size;
+                cachedBytes += result->summary.bytes;
+            }
+            continue;
+        }
+        // A log file whose result can't be cached is estimated by its size too.
+        statResult(result);
+        tmp = results[pending];
+        results[pending++] = *result;
+        *result = tmp;
+    }
+    sum = cachedTime;
+    for (size_t i = 0; i < pending; i++)
+    {
+        FileResult *result = &results[i];
+        CacheEntry entry;
+        // Compressed and plain log files are estimated by their own kind of bytes.
+        long long per = isLogGzFile(fileName(result->path)) ? cachedSize : cachedBytes;
+        if (result->key != NULL && findCacheEntry(&resultCache, result->key, &entry))
+            result->estimate = entry.summary.time;
         else
+            result->estimate = result->stated && per > 0 ? (time_t)((double)result->stamp.size * cachedTime / per) : 0;
+        sum += result->estimate;
+    }
+    qsort(results, pending, sizeof(FileResult), compareNewest);
+    printProvisional(sum, pending, count);
+    atomic_store(&provisionalTime, sum);
+    atomic_store(&provisionalPending, pending);
+    refining = 1;
+    LazyParse parse = {results, pending, 0, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER};
+    pthread_t thread;
+    if (pending > 0 && pthread_create(&thread, NULL, lazyWorker, &parse) == 0)
+    {
+        size_t printed = pending;
+        pthread_mutex_lock(&parse.mutex);
+        while (!parse.finished)
         {
-            if (name[i] != format[i])
-                return 0;
-            if (format[i] == '\0')
-                return 1;
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_sec++;
+            pthread_cond_timedwait(&parse.done, &parse.mutex, &deadline);
+            size_t left = atomic_load(&provisionalPending);
+            if (!parse.finished && left != printed)
+            {
+                printProvisional((time_t)atomic_load(&provisionalTime), left, count);
+                printed = left;
+            }
         }
-        i++;
+        pthread_mutex_unlock(&parse.mutex);
+        pthread_join(thread, NULL);
     }
+    else
+        parseFiles(results, pending);
+    refining = 0;
+    qsort(results, count, sizeof(FileResult), compareFileResult);
 }
 /**
- * @brief Change the working directory and terminate the program on failure.
- * @param[in] path The path to the new working directory.
+ * @brief Parse a list of log files and print the playtime of each one.
+ * @param[in,out] list The list of log files.
+ * @param[out] time A `time_t` pointer for outputting the total time.
+ * @return Return the number of parsed files.
  */
-void chdir_s(const char *path)
+int parseFileList(FileList *list, time_t *time)
 {
-    if (chdir(path) != 0)
+    qsort(list->results, list->count, sizeof(FileResult), compareFileResult);
+    if (lazy)
+        parseLazily(list->results, list->count);
+    else
+        parseFiles(list->results, list->count);
+    time_t sum = 0;
+    int file = 0;
+    for (size_t i = 0; i < list->count; i++)
     {
-        fprintf(stderr, "FATAL ERROR: Fail to chdir to %s: %s", path, strerror(errno));
-        exit(1);
+        FileResult *result = &list->results[i];
+        if (result->status != 0)
+            continue;
+        if (result->key != NULL && !result->cached)
+            updateCache(&resultCache, result->key, &result->stamp, &result->summary);
+        printResult(result->path, &result->summary);
+        addHistogram(result->path, &result->summary);
+        sum += result->summary.time, file++;
+        if (follow && strcmp(fileName(result->path), "latest.log") == 0)
+        {
+            // The rotated log files of the same directory sort right before its `latest.log`.
+            size_t dir = fileName(result->path) - result->path, first = i;
+            while (first > 0 &&
+                   (size_t)(fileName(list->results[first - 1].path) - list->results[first - 1].path) == dir &&
+                   strncmp(list->results[first - 1].path, result->path, dir) == 0)
+                first--;
+            if (addFollower(result->path, &result->summary, list->results + first, i - first) == 0)
+                continue;
+        }
+        addServedFile(result->path, &result->summary);
     }
+    *time = sum;
+    return file;
 }
 /**
  * @brief Parse a directory and calculate the playtime recorded by the log files within the directory.
- * @param[in] path The path to the log directory. If it is NULL, it will be treated as current working directory.
+ * @param[in] path The path to the log directory.
+ * @param[in] absolute The absolute path to the log directory if results can be cached, or NULL.
+ * @param[in,out] arena The arena that the list of log files is allocated from.
  * @param[out] time A `time_t` pointer for outputting time.
- * @param[in] origin The origin path. The function will chdir to it in the end if it isn't NULL.
  * @return Return the number of parsed files on success, or -1 on failure.
- * @note There is a more graceful way to realize by using openat() instead of chdir(), but MinGW doesn't support it.
  */
-int parseDirectory(const char *path, time_t *time, const char *origin)
+int parseDirectory(const char *path, const char *absolute, Arena *arena, time_t *time)
 {
-    if (path != NULL && chdir(path) != 0)
+    FileList list = {NULL, 0, 0, arena};
+    STATS_CLOCK(clock);
+    STATS_START(clock);
+    int ret = listDirectory(path, absolute, &list);
+    STATS_STOP(clock, MC_PHASE_ENUMERATE);
+    if (ret != 0)
         return -1;
-    DIR *dir = opendir(".");
-    if (dir == NULL)
-        return -1;
-    struct dirent *entry;
-    time_t sum = 0, tmp;
-    int file = 0;
-    while ((entry = readdir(dir)) != NULL)
-    {
-        if (isLogGzFile(entry->d_name))
-            if (parseFile(entry->d_name, &tmp) == 0)
-                sum += tmp, file++;
-    }
-    if (parseFile("latest.log", &tmp) == 0)
-        sum += tmp, file++;
-    closedir(dir);
-    *time = sum;
-    if (origin != NULL)
-        chdir_s(origin);
-    return file;
+    return parseFileList(&list, time);
 }
 /**
  * @brief Parse a `.minecraft` directory and calculate the time recorded by the log files within each `logs` directory.
- * @param[in] path The path to the `.minecraft` directory. If it is NULL, it will be treated as current working directory.
+ * @param[in] path The path to the `.minecraft` directory.
+ * @param[in] absolute The absolute path to the `.minecraft` directory if results can be cached, or NULL.
+ * @param[in,out] arena The arena that the list of log files is allocated from.
  * @param[out] time A `time_t` pointer for outputting time.
- * @param[in] origin The origin path. The function will chdir to it in the end if it isn't NULL.
  * @return Return the number of parsed files on success, or -1 on failure.
  */
-int parseDotMinecraftDirectory(const char *path, time_t *time, const char *origin)
+int parseDotMinecraftDirectory(const char *path, const char *absolute, Arena *arena, time_t *time)
 {
-    if (path != NULL && chdir(path) != 0)
+    FileList list = {NULL, 0, 0, arena};
+    STATS_CLOCK(clock);
+    STATS_START(clock);
+    int ret = listDotMinecraftDirectory(path, absolute, &list);
+    STATS_STOP(clock, MC_PHASE_ENUMERATE);
+    if (ret != 0)
         return -1;
-    time_t sum = 0, tmp;
-    int file = 0, ret;
-    if ((ret = parseDirectory("logs", &tmp, "..")) != -1)
-        sum += tmp, file += ret;
-    if (chdir("versions") != 0)
-        goto VERSIONS_END;
-    DIR *dir = opendir(".");
-    if (dir == NULL)
-        goto DIR_END;
-    struct dirent *entry;
-    while ((entry = readdir(dir)) != NULL)
-    {
-        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
-            continue;
-        if (chdir(entry->d_name) != 0)
-            continue;
-        if ((ret = parseDirectory("logs", &tmp, "..")) != -1)
-            sum += tmp, file += ret;
-        chdir_s("..");
-    }
-    closedir(dir);
-    DIR_END:
-    chdir_s("..");
-    VERSIONS_END:
-    *time = sum;
-    if (origin != NULL)
-        chdir_s(origin);
-    return file;
-}
-/**
- * @brief Get the current working directory and terminate the program on failure.
- * @return Return the path to the current working directory.
- */
-char *getcwd_s()
-{
-    char *ret = getcwd(NULL, 0);
-    if (ret == NULL)
-    {
-        fprintf(stderr, "FATAL ERROR: Fail to get current working directory: %s\n", strerror(errno));
-        exit(1);
-    }
-    return ret;
+    return parseFileList(&list, time);
 }
 /**
  * @brief Automatically recognize whether the path points to a file, a log directory or a .minecraft directory and parse it.
  * @param[in] path The path to the file or directory. If it is NULL, it will be treated as current working directory.
  * @param[out] time A `time_t` pointer for outputting time.
- * @param[in] origin The origin path. The function will chdir to it in the end if it isn't NULL.
  * @return Return the number of parsed files on success, or -1 on failure.
  */
-int autoParse(const char *path, time_t *time, const char *origin)
+int autoParse(const char *path, time_t *time)
 {
+    // The paths and results of the scan are all freed at the end of it.
+    Arena arena = {NULL};
     time_t tmp;
-    int file = 0, ret;
+    int file = -1, ret;
     struct stat status;
     if (path == NULL)
         path = ".";
     if (stat(path, &status) == -1)
     {
         fprintf(stderr, "ERROR: %s: %s\n", path, strerror(errno));
-        return -1;
+        goto END;
     }
     if (S_ISDIR(status.st_mode))
     {
-        if (chdir(path) != 0)
+        char *absolute = resolvePath(&arena, path);
+        if (absolute == NULL)
         {
             fprintf(stderr, "ERROR: %s: %s\n", path, strerror(errno));
-            return -1;
-        }
-        char *cwd = getcwd_s();
-        char *name = basename(cwd);
-        if (strcmp(name, ".minecraft") == 0)
-        {
-            switch(ret = parseDotMinecraftDirectory(NULL, &tmp, NULL))
-            {
-            case -1:
-                fprintf(stderr, "ERROR: %s: %s\n", path, strerror(errno));
-                return -1;
-            case 0:
-                fprintf(stderr, "WARNING: %s: No file parsed\n", path);
-                return -1;
-            default:
-                file += ret;
-            }
+            goto END;
         }
+        if (strcmp(fileName(absolute), ".minecraft") == 0)
+            ret = parseDotMinecraftDirectory(path, useCache ? absolute : NULL, &arena, &tmp);
         else
+            ret = parseDirectory(path, useCache ? absolute : NULL, &arena, &tmp);
+        switch (ret)
         {
-            switch (ret = parseDirectory(NULL, &tmp, NULL))
-            {
-            case -1:
-                fprintf(stderr, "ERROR: %s: %s\n", path, strerror(errno));
-                return -1;
-            case 0:
-                fprintf(stderr, "WARNING: %s: No file parsed\n", path);
-                return -1;
-            default:
-                file += ret;
-            }
+        case -1:
+            fprintf(stderr, "ERROR: %s: %s\n", path, strerror(errno));
+            goto END;
+        case 0:
+            fprintf(stderr, "WARNING: %s: No file parsed\n", path);
+            goto END;
+        default:
+            file = ret;
         }
-        free(cwd);
-        if (origin != NULL)
-            chdir_s(origin);
     }
     else if (S_ISREG(status.st_mode))
     {
-        switch (parseFile(path, &tmp))
+        FileResult result = {.path = (char *)path};
+        if (useCache && isLogGzFile(fileName(path)))
+            result.key = resolvePath(&arena, path);
+        parseResult(&result);
+        if (result.status == 0 && result.key != NULL && !result.cached)
+            updateCache(&resultCache, result.key, &result.stamp, &result.summary);
+        tmp = result.summary.time;
+        switch (result.status)
         {
         case 1:
             fprintf(stderr, "ERROR: %s: %s\n", path, strerror(errno));
-            return -1;
+            goto END;
         case 2:
             fprintf(stderr, "ERROR: %s: Not a minecraft log file\n", path);
-            return -1;
+            goto END;
         default:
-            file++;
+            printResult(path, &result.summary);
+            addHistogram(path, &result.summary);
+            if (!follow || isLogGzFile(fileName(path)) || addFollower(path, &result.summary, NULL, 0) != 0)
+                addServedFile(path, &result.summary);
+            file = 1;
         }
     }
     else
     {
         fprintf(stderr, "ERROR: %s: Not a directory or a regular file\n", path);
-        return -1;
+        goto END;
     }
     *time = tmp;
+    END:
+    freeArena(&arena);
+    return file;
+}
+/** Whether all paths are walked at once and their log files are parsed together without duplicates. */
+int multiRoot = 0;
+/**
+ * @brief A path given on the command line that is walked on its own thread in multi-root mode.
+ */
+typedef struct
+{
+    const char *path;  /**< The path to the file or directory. */
+    Arena arena;       /**< The arena that the log files found under the path are allocated from. */
+    FileList list;     /**< The log files found under the path. */
+    int status;        /**< 0 on success, 1 on system failure, or 2 if it is neither a directory nor a regular file. */
+    int error;         /**< The `errno` of a system failure. */
+} RootWalk;
+/**
+ * @brief Find the log files under a path and state each of them.
+ * @param[in,out] root The path. Its list, status and error are filled in.
+ * @note The errors are only reported by the caller so that they come out in the order of the paths.
+ */
+void walkRoot(RootWalk *root)
+{
+    FileList *list = &root->list;
+    STATS_CLOCK(clock);
+    STATS_START(clock);
+    list->arena = &root->arena;
+    struct stat status;
+    if (stat(root->path, &status) == -1)
+        goto FAIL;
+    if (S_ISDIR(status.st_mode))
+    {
+        char *absolute = resolvePath(&root->arena, root->path);
+        if (absolute == NULL)
+            goto FAIL;
+        if ((strcmp(fileName(absolute), ".minecraft") == 0
+                 ? listDotMinecraftDirectory(root->path, useCache ? absolute : NULL, list)
+                 : listDirectory(root->path, useCache ? absolute : NULL, list)) != 0)
+            goto FAIL;
+    }
+    else if (S_ISREG(status.st_mode))
+    {
+        FileResult *result = reserveResult(list);
+        if (result == NULL || (result->path = copyString(&root->arena, root->path)) == NULL)
+            goto FAIL;
+        if (useCache && isLogGzFile(fileName(root->path)))
+            result->key = resolvePath(&root->arena, root->path);
+        list->count++;
+    }
+    else
+    {
+        root->status = 2;
+        STATS_STOP(clock, MC_PHASE_ENUMERATE);
+        return;
+    }
+    // The identity is needed to drop duplicates, and the stamp comes with it for the cache.
+    for (size_t i = 0; i < list->count; i++)
+    {
+        FileResult *result = &list->results[i];
+        if (stat(result->path, &status) != 0)
+            continue;
+        result->device = status.st_dev;
+        result->stamp.inode = status.st_ino;
+        result->stamp.size = status.st_size;
+        result->stamp.mtime = status.st_mtime;
+        result->stated = 1;
+    }
+    STATS_STOP(clock, MC_PHASE_ENUMERATE);
+    return;
+    FAIL:
+    root->status = 1;
+    root->error = errno;
+    STATS_STOP(clock, MC_PHASE_ENUMERATE);
+}
+/**
+ * @brief The paths shared by the threads walking them.
+ */
+typedef struct
+{
+    RootWalk *roots;     /**< The paths. */
+    size_t count;        /**< The number of paths. */
+    atomic_size_t next;  /**< The index of the next path to walk. */
+} RootQueue;
+/**
+ * @brief Walk paths from a queue until it is exhausted.
+ * @param[in,out] arg A `RootQueue` pointer.
+ * @return Return NULL.
+ */
+void *walkWorker(void *arg)
+{
+    RootQueue *queue = arg;
+    size_t i;
+    while ((i = atomic_fetch_add(&queue->next, 1)) < queue->count)
+        walkRoot(&queue->roots[i]);
+    STATS_MERGE();
+    return NULL;
+}
+/**
+ * @brief A set of files identified by their device and inode.
+ */
+typedef struct
+{
+    unsigned long long *slots;  /**< Pairs of a device and an inode, where an inode of 0 marks an empty slot. */
+    size_t mask;                /**< The number of slots minus 1, which is a power of 2 minus 1. */
+} FileIdentitySet;
+/**
+ * @brief Add a file to a set of files unless it is already there.
+ * @param[in,out] set The set, which must have a free slot.
+ * @param[in] device The device of the file.
+ * @param[in] inode The inode of the file, which mustn't be 0.
+ * @return Return 1 if the file has been added, or 0 if it is already in the set.
+ */
+int addFileIdentity(FileIdentitySet *set, unsigned long long device, unsigned long long inode)
+{
+    unsigned long long hash = (inode ^ device * 0x9e3779b97f4a7c15ULL) * 0xff51afd7ed558ccdULL;
+    for (size_t i = (hash ^ hash >> 32) & set->mask;; i = (i + 1) & set->mask)
+    {
+        unsigned long long *slot = &set->slots[2 * i];
+        if (slot[1] == 0)
+        {
+            slot[0] = device, slot[1] = inode;
+            return 1;
+        }
+        if (slot[0] == device && slot[1] == inode)
+            return 0;
+    }
+}
+/**
+ * @brief Walk all paths at once, drop the log files found more than once and parse the others together.
+ * @param[in] paths The paths to files or directories.
+ * @param[in] count The number of paths.
+ * @param[out] time A `time_t` pointer for outputting the total time.
+ * @return Return the number of parsed files.
+ * @note A file reached through several paths, e.g. `./.minecraft` and `./.minecraft/logs`, is counted once under the
+ * first path that reaches it. Files that report no inode, as on Windows, are never taken for duplicates.
+ */
+int parseRoots(char **paths, int count, time_t *time)
+{
+    Arena arena = {NULL};
+    FileList merged = {NULL, 0, 0, &arena};
+    FileIdentitySet set = {NULL, 0};
+    RootQueue queue = {calloc(count, sizeof(RootWalk)), count, 0};
+    int file = 0;
+    *time = 0;
+    if (queue.roots == NULL)
+    {
+        fprintf(stderr, "ERROR: %s\n", strerror(errno));
+        return 0;
+    }
+    for (int i = 0; i < count; i++)
+        queue.roots[i].path = paths[i];
+    size_t threads = (size_t)options.jobs < queue.count ? (size_t)options.jobs : queue.count, created = 0;
+    pthread_t *thread = threads > 1 ? malloc((threads - 1) * sizeof(pthread_t)) : NULL;
+    if (thread != NULL)
+        while (created < threads - 1 && pthread_create(&thread[created], NULL, walkWorker, &queue) == 0)
+            created++;
+    walkWorker(&queue);
+    for (size_t i = 0; i < created; i++)
+        pthread_join(thread[i], NULL);
+    free(thread);
+    size_t total = 0;
+    for (int i = 0; i < count; i++)
+        total += queue.roots[i].list.count;
+    for (set.mask = 15; set.mask < 2 * total; set.mask = set.mask * 2 + 1)
+        ;
+    if ((set.slots = calloc(set.mask + 1, 2 * sizeof(unsigned long long))) == NULL)
+    {
+        fprintf(stderr, "ERROR: %s\n", strerror(errno));
+        goto END;
+    }
+    for (int i = 0; i < count; i++)
+    {
+        RootWalk *root = &queue.roots[i];
+        if (root->status == 1)
+            fprintf(stderr, "ERROR: %s: %s\n", root->path, strerror(root->error));
+        else if (root->status == 2)
+            fprintf(stderr, "ERROR: %s: Not a directory or a regular file\n", root->path);
+        else if (root->list.count == 0)
+            fprintf(stderr, "WARNING: %s: No file parsed\n", root->path);
+        for (size_t j = 0; j < root->list.count; j++)
+        {
+            const FileResult *result = &root->list.results[j];
+            if (result->stated && result->stamp.inode != 0 &&
+                !addFileIdentity(&set, result->device, result->stamp.inode))
+                continue;
+            FileResult *copy = reserveResult(&merged);
+            if (copy == NULL)
+            {
+                fprintf(stderr, "ERROR: %s\n", strerror(errno));
+                goto END;
+            }
+            *copy = *result;
+            merged.count++;
+        }
+    }
+    file = parseFileList(&merged, time);
+    END:
+    free(set.slots);
+    freeArena(&arena);
+    for (int i = 0; i < count; i++)
+        freeArena(&queue.roots[i].arena);
+    free(queue.roots);
     return file;
 }
+/**
+ * @brief Print a total time.
+ * @param[in] sum The total time.
+ */
+void printTotal(time_t sum)
+{
+    printOutput("total time: %lld = %lldh %lldmin %llds\n", (long long)sum, (long long)sum / 60 / 60,
+                (long long)sum / 60 % 60, (long long)sum % 60);
+}
+/**
+ * @brief Update a followed log file with a line appended to it.
+ * @param[in,out] follower The followed log file.
+ * @param[in] line The start of the line.
+ * @param[in] length The length of the line.
+ * @return Return 1 if the times have changed, or 0 otherwise.
+ */
+int followLine(Follower *follower, const char *line, size_t length)
+{
+    if (!mcAddLine(&follower->engine, line, length))
+        return 0;
+    mcFinishSessions(&follower->engine, &follower->summary);
+    return 1;
+}
+/**
+ * @brief Parse the rotated log files that have appeared next to a followed log file.
+ * @param[in,out] follower The followed log file.
+ * @return Return the playtime recorded by the new rotated log files.
+ */
+time_t followRotated(Follower *follower)
+{
+    DirListing listing;
+    if (openListing(&listing, follower->dir) != 0)
+        return 0;
+    time_t sum = 0;
+    char **tmp;
+    Arena arena = {NULL};
+    while (readListing(&listing))
+    {
+        const char *name = listing.name;
+        if (!isLogGzFile(name) || !isDateInRange(name) ||
+            bsearch(&name, follower->known, follower->knownCount, sizeof(char *), compareString))
+            continue;
+        FileResult result = {.path = joinPath(&arena, follower->dir, name)};
+        if (follower->absolute != NULL)
+            result.key = joinPath(&arena, follower->absolute, name);
+        if (result.path != NULL)
+            parseResult(&result);
+        // A file that can't be parsed may still be being written, so it is tried again on the next listing.
+        if (result.path != NULL && result.status == 0 &&
+            (tmp = realloc(follower->known, (follower->knownCount + 1) * sizeof(char *))) != NULL)
+        {
+            follower->known = tmp;
+            if ((follower->known[follower->knownCount] = strdup(name)) != NULL)
+            {
+                follower->knownCount++;
+                if (result.key != NULL && !result.cached)
+                    updateCache(&resultCache, result.key, &result.stamp, &result.summary);
+                printResult(result.path, &result.summary);
+                addServedFile(result.path, &result.summary);
+                sum += result.summary.time;
+            }
+        }
+    }
+    freeArena(&arena);
+    closeListing(&listing);
+    qsort(follower->known, follower->knownCount, sizeof(char *), compareString);
+    return sum;
+}
+/**
+ * @brief Parse the bytes appended to a followed log file since it was last updated.
+ * @param[in,out] follower The followed log file.
+ * @param[in,out] base The total time of all log files that aren't followed.
+ * @return Return 1 if any time has changed, or 0 otherwise.
+ * @note The log file is started over when it has been truncated or replaced, and its old content is counted through
+ * the rotated log file it has been moved to.
+ */
+int updateFollower(Follower *follower, time_t *base)
+{
+    static char buffer[MC_SCAN_BUFFER_SIZE];
+    struct stat status;
+    int changed = 0;
+    // The modification time only has a resolution of seconds, so a directory modified just now is listed again.
+    if (follower->rotated && stat(follower->dir, &status) == 0 &&
+        (status.st_mtime != follower->dirMtime || status.st_mtime >= time(NULL) - 1))
+    {
+        follower->dirMtime = status.st_mtime;
+        time_t rotatedTime = followRotated(follower);
+        *base += rotatedTime, changed |= rotatedTime != 0;
+    }
+    int fd = open(follower->path, O_RDONLY | O_BINARY);
+    if (fd == -1)
+        return changed;
+    if (fstat(fd, &status) != 0)
+    {
+        close(fd);
+        return changed;
+    }
+    if ((unsigned long long)status.st_ino != follower->inode || status.st_size < follower->offset)
+    {
+        follower->inode = status.st_ino;
+        follower->offset = 0;
+        follower->skip = 0;
+        mcStartSessions(&follower->engine, &options);
+        memset(&follower->summary, 0, sizeof(McSummary));
+        changed = 1;
+    }
+    while (follower->offset < status.st_size && lseek(fd, follower->offset, SEEK_SET) == follower->offset)
+    {
+        long ret = read(fd, buffer, MC_SCAN_BUFFER_SIZE);
+        if (ret <= 0)
+            break;
+        const char *p = buffer, *end = buffer + ret, *newline;
+        if (follower->skip)
+        {
+            if ((newline = memchr(p, '\n', end - p)) == NULL)
+            {
+                follower->offset += ret;
+                continue;
+            }
+            p = newline + 1;
+            follower->skip = 0;
+        }
+        while ((newline = memchr(p, '\n', end - p)) != NULL)
+        {
+            changed |= followLine(follower, p, newline - p);
+            p = newline + 1;
+        }
+        if (p == buffer && ret == MC_SCAN_BUFFER_SIZE)
+        {
+            changed |= followLine(follower, p, end - p);
+            follower->skip = 1;
+            p = end;
+        }
+        // An incomplete last line is parsed again once it has been finished.
+        follower->offset += p - buffer;
+        if (p != end)
+            break;
+    }
+    follower->summary.bytes = follower->offset;
+    close(fd);
+    return changed;
+}
+/**
+ * @brief Sum the playtime of the log files in memory.
+ * @param[in] profile The version whose log files are summed, "" for those outside of any version, or NULL for all.
+ * @param[in] date A prefix of `yyyy-MM-dd` that the dates of the summed log files start with, or NULL for all.
+ * @return Return the playtime.
+ */
+time_t sumServedFiles(const char *profile, const char *date)
+{
+    time_t sum = 0;
+    size_t length = date != NULL ? strlen(date) : 0;
+    for (size_t i = 0; i < servedCount; i++)
+        if ((profile == NULL || strcmp(servedFiles[i].profile, profile) == 0) &&
+            (date == NULL || strncmp(servedFiles[i].date, date, length) == 0))
+            sum += servedFiles[i].time;
+    for (size_t i = 0; i < followerCount; i++)
+        if ((profile == NULL || (followers[i].profile != NULL && strcmp(followers[i].profile, profile) == 0)) &&
+            (date == NULL || strncmp(followers[i].date, date, length) == 0))
+            sum += followers[i].summary.time;
+    return sum;
+}
+#ifndef _WIN32
+/** The socket that `--serve` accepts queries on, or -1. */
+int serverFd = -1;
+/**
+ * @brief Listen for queries on a Unix socket.
+ * @param[in] path The path to the socket, which replaces any file there.
+ * @return Return 0 on success, or -1 on failure.
+ */
+int openServer(const char *path)
+{
+    struct sockaddr_un address;
+    if (strlen(path) >= sizeof(address.sun_path))
+    {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+    if ((serverFd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1)
+        return -1;
+    unlink(path);
+    if (bind(serverFd, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(serverFd, 64) != 0)
+    {
+        close(serverFd);
+        serverFd = -1;
+        return -1;
+    }
+    // A client that goes away before reading its answer mustn't end the server.
+    signal(SIGPIPE, SIG_IGN);
+    serving = 1;
+    return 0;
+}
+/**
+ * @brief Answer one query from a client of the server from the results in memory.
+ * @note A query is one line of `total`, `profile [<name>]` or `day <date>`, where `<date>` is yyyy, yyyy-MM or
+ * yyyy-MM-dd. Without a name, `profile` sums the log files outside of any version. The answer is the playtime in
+ * seconds on one line, or a line starting with `error:`.
+ */
+void answerQuery()
+{
+    int client = accept(serverFd, NULL, NULL);
+    if (client == -1)
+        return;
+    // A slow client is dropped instead of stalling the updates of the followed files.
+    struct timeval timeout = {1, 0};
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    char request[256], answer[64];
+    size_t length = 0;
+    long ret;
+    while (length < sizeof(request) - 1 && memchr(request, '\n', length) == NULL &&
+           (ret = recv(client, request + length, sizeof(request) - 1 - length, 0)) > 0)
+        length += ret;
+    request[length] = '\0';
+    request[strcspn(request, "\r\n")] = '\0';
+    if (strcmp(request, "total") == 0)
+        sprintf(answer, "%lld\n", (long long)sumServedFiles(NULL, NULL));
+    else if (strcmp(request, "profile") == 0 || strncmp(request, "profile ", 8) == 0)
+        sprintf(answer, "%lld\n", (long long)sumServedFiles(request[7] != '\0' ? request + 8 : "", NULL));
+    else if (strncmp(request, "day ", 4) == 0 && isDatePrefix(request + 4))
+        sprintf(answer, "%lld\n", (long long)sumServedFiles(NULL, request + 4));
+    else
+        strcpy(answer, "error: unknown query\n");
+    send(client, answer, strlen(answer), 0);
+    close(client);
+}
+#endif
+/**
+ * @brief Follow the `latest.log` files found by the scan and print the total time whenever it changes.
+ * @param[in] sum The total time found by the scan.
+ * @param[in] cachePath The path to the cache index file, or NULL if the cache isn't used.
+ * @note It never returns. With `--serve`, queries are answered in between from memory, without touching the files.
+ */
+void followLogs(time_t sum, const char *cachePath)
+{
+    time_t base = sum;
+    for (size_t i = 0; i < followerCount; i++)
+        base -= followers[i].summary.time;
+#ifdef __linux__
+    int fd = inotify_init1(IN_CLOEXEC);
+    for (size_t i = 0; fd != -1 && i < followerCount; i++)
+        if (inotify_add_watch(fd, followers[i].dir, IN_MODIFY | IN_CREATE | IN_MOVED_TO | IN_CLOSE_WRITE) == -1)
+        {
+            close(fd);
+            fd = -1;
+        }
+#endif
+    time_t updated = 0;
+    for (;;)
+    {
+#ifdef _WIN32
+        Sleep(1000);
+#else
+        struct pollfd events[2];
+        nfds_t count = 0;
+        int notified = 0, interval = 1;
+#ifdef __linux__
+        if (fd != -1)
+            events[count++] = (struct pollfd){fd, POLLIN, 0}, interval = 5;
+#endif
+        if (serverFd != -1)
+            events[count++] = (struct pollfd){serverFd, POLLIN, 0};
+        // Without change notifications the files are checked every second, and with them now and then anyway in case
+        // an event has been missed.
+        if (poll(events, count, interval * 1000) > 0)
+        {
+            if (serverFd != -1 && (events[count - 1].revents & POLLIN))
+                answerQuery();
+#ifdef __linux__
+            char buffer[4096];
+            if (fd != -1 && (events[0].revents & POLLIN))
+                while (read(fd, buffer, sizeof(buffer)) == sizeof(buffer))
+                    ;
+            notified = fd != -1 && (events[0].revents & POLLIN);
+#endif
+        }
+        if (!notified && time(NULL) - updated < interval)
+            continue;
+        updated = time(NULL);
+#endif
+        int changed = 0;
+        for (size_t i = 0; i < followerCount; i++)
+            if (updateFollower(&followers[i], &base))
+            {
+                if (serving && getLogFileDate(followers[i].path, followers[i].date) != 0)
+                    followers[i].date[0] = '\0';
+                // A machine-readable output gets the new record of each changed file instead of a total.
+                if (outputFormat != OUTPUT_TEXT)
+                    printResult(followers[i].path, &followers[i].summary);
+                changed = 1;
+            }
+        if (!changed)
+            continue;
+        time_t total = base;
+        for (size_t i = 0; i < followerCount; i++)
+            total += followers[i].summary.time;
+        if (total != sum && outputFormat == OUTPUT_TEXT)
+            printTotal(total);
+        sum = total;
+        flushOutput();
+        if (cachePath != NULL)
+            saveCache(&resultCache, cachePath);
+    }
+}
 int main(int argc, char* argv[])
 {
     time_t sum = 0, tmp;
-    int file = 0, ret;
-    if (argc == 1)
+    int file = 0, ret, paths = 0;
+    size_t memoryBudget = 0;
+#ifndef _WIN32
+    const char *servePath = NULL;
+#endif
+    mcInitOptions(&options);
+#ifdef _WIN32
+    // With the UTF-8 code page of the manifest, paths are printed as they are to the console.
+    if (GetACP() == CP_UTF8)
+        SetConsoleOutputCP(CP_UTF8);
+#endif
+    for (int i = 1; i < argc; i++)
+    {
+        if (strncmp(argv[i], "-j", 2) == 0)
+        {
+            const char *value = argv[i][2] != '\0' ? argv[i] + 2 : i + 1 < argc ? argv[++i] : "";
+            char *end;
+            long n = strtol(value, &end, 10);
+            if (*value == '\0' || *end != '\0' || n < 1 || n > 1024)
+            {
+                fprintf(stderr, "ERROR: Invalid number of jobs: %s\n", value);
+                return 1;
+            }
+            options.jobs = n;
+        }
+        else if (strcmp(argv[i], "--max-memory") == 0)
+        {
+            const char *value = i + 1 < argc ? argv[++i] : "";
+            char *end;
+            long n = strtol(value, &end, 10);
+            if (*value == '\0' || *end != '\0' || n < 1 || (unsigned long)n > SIZE_MAX / 1024 / 1024)
+            {
+                fprintf(stderr, "ERROR: Invalid memory budget: %s\n", value);
+                return 1;
+            }
+            memoryBudget = (size_t)n * 1024 * 1024;
+        }
+        else if (strcmp(argv[i], "--gap") == 0)
+        {
+            const char *value = i + 1 < argc ? argv[++i] : "";
+            char *end;
+            long long n = strtoll(value, &end, 10);
+            if (*value == '\0' || *end != '\0' || n < 0)
+            {
+                fprintf(stderr, "ERROR: Invalid gap: %s\n", value);
+                return 1;
+            }
+            options.sessionGap = n;
+        }
+        else if (strcmp(argv[i], "--join") == 0 || strcmp(argv[i], "--leave") == 0)
+        {
+            int join = argv[i][2] == 'j';
+            const char **markers = join ? options.joinMarkers : options.leaveMarkers;
+            int *count = join ? &options.joinMarkerCount : &options.leaveMarkerCount;
+            if (i + 1 >= argc || argv[i + 1][0] == '\0')
+            {
+                fprintf(stderr, "ERROR: %s: Missing text\n", argv[i]);
+                return 1;
+            }
+            if (*count == MC_MAX_MARKERS)
+            {
+                fprintf(stderr, "ERROR: %s: Too many markers\n", argv[i]);
+                return 1;
+            }
+            markers[(*count)++] = argv[++i];
+        }
+        else if (strcmp(argv[i], "--since") == 0 || strcmp(argv[i], "--until") == 0)
+        {
+            if (i + 1 >= argc || !isDatePrefix(argv[i + 1]))
+            {
+                fprintf(stderr, "ERROR: %s: Invalid date: %s\n", argv[i], i + 1 < argc ? argv[i + 1] : "");
+                return 1;
+            }
+            if (argv[i][2] == 's')
+                sinceDate = argv[++i];
+            else
+                untilDate = argv[++i];
+        }
+        else if (strcmp(argv[i], "--profile") == 0)
+        {
+            if (i + 1 >= argc || argv[i + 1][0] == '\0' || strpbrk(argv[i + 1], "/\\") != NULL ||
+                strcmp(argv[i + 1], ".") == 0 || strcmp(argv[i + 1], "..") == 0)
+            {
+                fprintf(stderr, "ERROR: %s: Invalid profile: %s\n", argv[i], i + 1 < argc ? argv[i + 1] : "");
+                return 1;
+            }
+            if (profileCount == MAX_PROFILES)
+            {
+                fprintf(stderr, "ERROR: %s: Too many profiles\n", argv[i]);
+                return 1;
+            }
+            profiles[profileCount++] = argv[++i];
+        }
+        else if (strncmp(argv[i], "--format", 8) == 0 && (argv[i][8] == '=' || argv[i][8] == '\0'))
+        {
+            const char *value = argv[i][8] == '=' ? argv[i] + 9 : i + 1 < argc ? argv[++i] : "";
+            if (strcmp(value, "text") == 0)
+                outputFormat = OUTPUT_TEXT;
+            else if (strcmp(value, "jsonl") == 0)
+                outputFormat = OUTPUT_JSONL;
+            else if (strcmp(value, "csv") == 0)
+                outputFormat = OUTPUT_CSV;
+            else
+            {
+                fprintf(stderr, "ERROR: Invalid output format: %s\n", value);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--tail-seek") == 0)
+            options.tailSeek = 1;
+        else if (strcmp(argv[i], "--prefetch") == 0)
+            prefetch = 1;
+        else if (strcmp(argv[i], "--multi-root") == 0)
+            multiRoot = 1;
+        else if (strcmp(argv[i], "--serve") == 0)
+        {
+            if (i + 1 >= argc || argv[i + 1][0] == '\0')
+            {
+                fprintf(stderr, "ERROR: %s: Missing socket path\n", argv[i]);
+                return 1;
+            }
+#ifdef _WIN32
+            fprintf(stderr, "ERROR: --serve: Not supported by this build\n");
+            return 1;
+#else
+            servePath = argv[++i];
+            follow = 1;
+#endif
+        }
+        else if (strcmp(argv[i], "--histogram") == 0)
+            showHistogram = 1;
+        else if (strcmp(argv[i], "--lazy") == 0)
+            lazy = 1;
+        else if (strcmp(argv[i], "--no-cache") == 0)
+            useCache = 0;
+        else if (strcmp(argv[i], "--follow") == 0)
+            follow = 1;
+        else if (strcmp(argv[i], "--stats") == 0)
+        {
+#ifdef ENABLE_STATS
+            showStats = options.timing = 1;
+#else
+            fprintf(stderr, "ERROR: --stats: Not supported by this build\n");
+            return 1;
+#endif
+        }
+        else
+            argv[paths++] = argv[i];
+    }
+    if (memoryBudget > 0)
+    {
+        // With --prefetch, half of the budget is for the log files read ahead. The rest is shared by the parsers.
+        size_t parsers = prefetch ? memoryBudget / 2 : memoryBudget;
+        prefetchBudget = memoryBudget - parsers;
+        options.memoryLimit = parsers / options.jobs;
+    }
+    if (showHistogram && outputFormat == OUTPUT_CSV)
+    {
+        fprintf(stderr, "ERROR: --histogram: Not supported with --format=csv\n");
+        return 1;
+    }
+    if (lazy && outputFormat == OUTPUT_CSV)
+    {
+        fprintf(stderr, "ERROR: --lazy: Not supported with --format=csv\n");
+        return 1;
+    }
+    if (paths == 0)
     {
         printf(help);
         return 0;
     }
     else
     {
-        char *origin = getcwd_s();
-        for (int i = 1; i < argc; i++)
-            if ((ret = autoParse(argv[i], &tmp, origin)) != -1)
-                sum += tmp, file += ret;
-        free(origin);
+#ifdef ENABLE_STATS
+        double started = mcReadClock(CLOCK_MONOTONIC);
+#endif
+#ifndef _WIN32
+        // The socket is opened first so that a wrong path fails before the scan.
+        if (servePath != NULL && openServer(servePath) != 0)
+        {
+            fprintf(stderr, "ERROR: %s: %s\n", servePath, strerror(errno));
+            return 1;
+        }
+#endif
+        // The indexed files parsed at once share `-j` threads between their file workers and their chunks.
+        if (options.jobs > 1)
+            options.threads = mcCreateThreadBudget(options.jobs);
+        char *cachePath = useCache ? getCachePath() : NULL;
+        if (cachePath != NULL)
+        {
+            loadCache(&resultCache, cachePath);
+            // The access point indexes are kept next to the cache index.
+            if ((indexDir = malloc(strlen(cachePath) + 8)) != NULL)
+                sprintf(indexDir, "%.*szran", (int)(fileName(cachePath) - cachePath), cachePath);
+        }
+        else
+            useCache = 0;
+        if (multiRoot)
+            file = parseRoots(argv, paths, &sum);
+        else
+            for (int i = 0; i < paths; i++)
+                if ((ret = autoParse(argv[i], &tmp)) != -1)
+                    sum += tmp, file += ret;
+        if (cachePath != NULL && saveCache(&resultCache, cachePath) != 0)
+            fprintf(stderr, "WARNING: %s: Fail to save cache: %s\n", cachePath, strerror(errno));
+        if (outputFormat == OUTPUT_TEXT)
+        {
+            printOutput("%d files parsed\n", file);
+            printTotal(sum);
+        }
+        if (showHistogram)
+            printHistogram();
+        flushOutput();
+#ifdef ENABLE_STATS
+        if (showStats)
+            printStats(mcReadClock(CLOCK_MONOTONIC) - started);
+#endif
+        if (follow)
+            followLogs(sum, cachePath);
+        releaseParser();
+        mcFreeThreadBudget(options.threads);
+        free(dayTimes);
+        free(indexDir);
+        free(cachePath);
+        freeCache(&resultCache);
     }
-    printf("%d files parsed\n", file);
-    printf("total time: %d = %dh %dmin %ds\n", sum, sum / 60 / 60, sum / 60 % 60, sum % 60);
     return 0;
 }
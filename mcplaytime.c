@@ -0,0 +1,2274 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2023 Happy_Arno
+#include "mcplaytime.h"
+#include <stdio.h>
+#include <sys/stat.h>
+#ifdef USE_ZLIB_NG
+#include <zlib-ng.h>
+#define z_stream zng_stream
+#define inflateInit2 zng_inflateInit2
+#define inflate zng_inflate
+#define inflatePrime zng_inflatePrime
+#define inflateSetDictionary zng_inflateSetDictionary
+#define inflateReset2 zng_inflateReset2
+#define inflateEnd zng_inflateEnd
+#else
+#include <zlib.h>
+#endif
+#ifdef USE_LIBDEFLATE
+#include <libdeflate.h>
+#endif
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#ifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+#ifdef ENABLE_SIMD
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define USE_SSE2
+#include <emmintrin.h>
+#if defined(__GNUC__) || defined(_MSC_VER)
+// AVX2 is only used where the CPU reports it at run time, so the rest of the library doesn't require it.
+#define USE_AVX2
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define USE_NEON
+#include <arm_neon.h>
+#endif
+#endif
+/** The length of the longest timestamp tag at the start of a line. */
+#define TAG_LENGTH 20
+/** The number of seconds in an hour. */
+#define HOUR_SECONDS (60 * 60)
+#ifdef ENABLE_STATS
+double mcReadClock(clockid_t id)
+{
+    struct timespec ts;
+    clock_gettime(id, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+void mcStartClock(McClock *clock, const McStats *stats)
+{
+    clock->wall = mcReadClock(CLOCK_MONOTONIC);
+    clock->cpu = mcReadClock(CLOCK_THREAD_CPUTIME_ID);
+    clock->inflateWall = stats->wall[MC_PHASE_INFLATE];
+    clock->inflateCpu = stats->cpu[MC_PHASE_INFLATE];
+}
+void mcStopClock(const McClock *clock, McStats *stats, McPhase phase)
+{
+    stats->wall[phase] += mcReadClock(CLOCK_MONOTONIC) - clock->wall;
+    stats->cpu[phase] += mcReadClock(CLOCK_THREAD_CPUTIME_ID) - clock->cpu;
+    if (phase == MC_PHASE_SCAN)
+    {
+        stats->wall[phase] -= stats->wall[MC_PHASE_INFLATE] - clock->inflateWall;
+        stats->cpu[phase] -= stats->cpu[MC_PHASE_INFLATE] - clock->inflateCpu;
+    }
+}
+#define PHASE_CLOCK(name) McClock name
+#define PHASE_START(name, timing, stats) do { if (timing) mcStartClock(&(name), stats); } while (0)
+#define PHASE_STOP(name, timing, stats, phase) do { if (timing) mcStopClock(&(name), stats, phase); } while (0)
+#else
+#define PHASE_CLOCK(name)
+#define PHASE_START(name, timing, stats) do { } while (0)
+#define PHASE_STOP(name, timing, stats, phase) do { } while (0)
+#endif
+/** The size of the window that inflating is resumed with at an access point. */
+#define WINDOW_SIZE 32768
+/** The size of the compressed data read at once when streaming a gzip file. */
+#define INPUT_SIZE (64 * 1024)
+/** The least number of decompressed bytes between two access points. */
+#define INDEX_SPAN (16 * 1024 * 1024)
+/**
+ * @brief A point of a gzip file from which inflating can be resumed.
+ */
+typedef struct
+{
+    long long out;                      /**< The offset in the decompressed data. */
+    long long in;                       /**< The offset of the first full byte of compressed data. */
+    int bits;                           /**< The number of bits of the byte before `in` that are still to be read. */
+    unsigned char window[WINDOW_SIZE];  /**< The decompressed bytes right before the point. */
+} AccessPoint;
+/**
+ * @brief An index of the access points of a gzip file, as built by zlib's `examples/zran.c`.
+ */
+typedef struct
+{
+    McFileStamp stamp;    /**< The version of the file that is indexed. */
+    long long size;       /**< The size of the decompressed data. */
+    AccessPoint *points;  /**< The access points after the start of the file in order. */
+    size_t count;         /**< The number of access points. */
+    size_t capacity;      /**< The capacity of the access point array. */
+} AccessIndex;
+/**
+ * @brief A reader that inflates a gzip file from its start or from an access point.
+ * @note The inflate stream and the input buffer are kept from one file to the next.
+ */
+typedef struct
+{
+    z_stream stream;            /**< The inflate stream. */
+    int fd;                     /**< The file being read, or -1 if it is in memory. */
+    const unsigned char *data;  /**< The content of the file if it is in memory. */
+    size_t size;                /**< The size of the file if it is in memory. */
+    unsigned char *input;       /**< A buffer of `INPUT_SIZE` bytes of compressed data. */
+    long long in;               /**< The offset of the next compressed byte to be read from the file. */
+    long long out;              /**< The offset of the next decompressed byte. */
+    long long limit;            /**< The offset after which only the rest of the current line is produced, or -1. */
+    int raw;                    /**< Whether the current member is inflated without its gzip header and trailer. */
+    int done;                   /**< Whether the end has been reached. */
+    int error;                  /**< Whether an error has occurred. */
+    AccessIndex *index;         /**< The index being built, or NULL. */
+    unsigned char *window;      /**< A ring of the last `WINDOW_SIZE` decompressed bytes while building an index. */
+#ifdef _WIN32
+    HANDLE file;                /**< The file reopened for overlapped reads, INVALID_HANDLE_VALUE, or NULL if unopened. */
+    OVERLAPPED request;         /**< The read that fills `ahead`. */
+    unsigned char *ahead;       /**< A buffer of `INPUT_SIZE` bytes that the next compressed bytes are read into. */
+    int pending;                /**< Whether the read into `ahead` has been issued. */
+#endif
+} InflateReader;
+#ifdef _WIN32
+/**
+ * @brief Cancel the read of a reader that is in flight, if any.
+ * @param[in,out] reader The reader.
+ */
+static void cancelRead(InflateReader *reader)
+{
+    DWORD got;
+    if (!reader->pending)
+        return;
+    // The buffer mustn't be reused before the read is known to have stopped.
+    CancelIoEx(reader->file, &reader->request);
+    GetOverlappedResult(reader->file, &reader->request, &got, TRUE);
+    reader->pending = 0;
+}
+/**
+ * @brief Close the handle that a reader has reopened for overlapped reads.
+ * @param[in,out] reader The reader.
+ */
+static void closeOverlapped(InflateReader *reader)
+{
+    if (reader->file != NULL && reader->file != INVALID_HANDLE_VALUE)
+    {
+        cancelRead(reader);
+        CloseHandle(reader->file);
+    }
+    reader->file = NULL;
+}
+/**
+ * @brief Issue an overlapped read of the compressed bytes at an offset into the buffer ahead of a reader.
+ * @param[in,out] reader The reader, which has no read in flight.
+ * @param[in] offset The offset in the file.
+ * @return Return 0 on success, or -1 on failure with the error left to `GetLastError()`.
+ */
+static int issueRead(InflateReader *reader, long long offset)
+{
+    reader->request.Internal = reader->request.InternalHigh = 0;
+    reader->request.Offset = (DWORD)offset;
+    reader->request.OffsetHigh = (DWORD)(offset >> 32);
+    if (!ReadFile(reader->file, reader->ahead, INPUT_SIZE, NULL, &reader->request) && GetLastError() != ERROR_IO_PENDING)
+        return -1;
+    reader->pending = 1;
+    return 0;
+}
+/**
+ * @brief Give the inflate stream of a reader the next compressed bytes through overlapped reads.
+ * @param[in,out] reader The reader, whose stream has no input left.
+ * @return Return the number of bytes, 0 at the end of the file, or -1 on failure.
+ * @note The bytes after them are read while they are inflated, so the decompressor rarely waits for the disk.
+ */
+static long readOverlapped(InflateReader *reader)
+{
+    DWORD got = 0;
+    long long offset = (long long)reader->request.OffsetHigh << 32 | reader->request.Offset;
+    // The reader moves on its own only when a raw member is followed by a new one.
+    if (reader->pending && offset != reader->in)
+        cancelRead(reader);
+    if (!reader->pending && issueRead(reader, reader->in) != 0)
+        return GetLastError() == ERROR_HANDLE_EOF ? 0 : -1;
+    reader->pending = 0;
+    if (!GetOverlappedResult(reader->file, &reader->request, &got, TRUE))
+        return GetLastError() == ERROR_HANDLE_EOF ? 0 : -1;
+    unsigned char *input = reader->input;
+    reader->input = reader->ahead;
+    reader->ahead = input;
+    reader->stream.next_in = reader->input;
+    // A failure of the read ahead is only reported once its bytes are needed.
+    if (got > 0)
+        issueRead(reader, reader->in + got);
+    return (long)got;
+}
+#endif
+/**
+ * @brief Allocate the inflate stream and the input buffer of a reader.
+ * @param[out] reader The reader.
+ * @return Return 0 on success, or -1 on failure.
+ */
+static int initReader(InflateReader *reader)
+{
+    memset(reader, 0, sizeof(InflateReader));
+    reader->fd = -1;
+    if ((reader->input = malloc(INPUT_SIZE)) == NULL)
+        return -1;
+    if (inflateInit2(&reader->stream, 47) != Z_OK)
+    {
+        free(reader->input);
+        return -1;
+    }
+#ifdef _WIN32
+    // Without the second buffer or the event, files are read by `read()` as on other systems.
+    if ((reader->request.hEvent = CreateEventW(NULL, TRUE, FALSE, NULL)) != NULL &&
+        (reader->ahead = malloc(INPUT_SIZE)) == NULL)
+    {
+        CloseHandle(reader->request.hEvent);
+        reader->request.hEvent = NULL;
+    }
+#endif
+    return 0;
+}
+/**
+ * @brief Free the inflate stream and the input buffer of a reader.
+ * @param[in,out] reader The reader.
+ */
+static void freeReader(InflateReader *reader)
+{
+    inflateEnd(&reader->stream);
+    free(reader->input);
+#ifdef _WIN32
+    closeOverlapped(reader);
+    free(reader->ahead);
+    if (reader->request.hEvent != NULL)
+        CloseHandle(reader->request.hEvent);
+#endif
+}
+/**
+ * @brief Reset a reader for another file.
+ * @param[in,out] reader The reader.
+ * @param[in] windowBits The window bits that inflating starts with: 47 for a gzip header, or -15 for raw deflate data.
+ * @return Return 0 on success, or -1 on failure.
+ */
+static int resetReader(InflateReader *reader, int windowBits)
+{
+#ifdef _WIN32
+    closeOverlapped(reader);
+#endif
+    reader->fd = -1;
+    reader->data = NULL;
+    reader->size = 0;
+    reader->in = reader->out = 0;
+    reader->limit = -1;
+    reader->raw = reader->done = reader->error = 0;
+    reader->index = NULL;
+    reader->window = NULL;
+    reader->stream.next_in = NULL;
+    reader->stream.avail_in = 0;
+    return inflateReset2(&reader->stream, windowBits) == Z_OK ? 0 : -1;
+}
+/**
+ * @brief Start inflating a gzip file.
+ * @param[in,out] reader The reader, which has been allocated by `initReader()`.
+ * @param[in] fd The gzip file.
+ * @param[in] point The access point to start from, or NULL to start from the beginning.
+ * @param[in] limit The offset after which only the rest of the current line is produced, or -1 for no limit.
+ * @param[in,out] index The index to which access points are added while reading, or NULL.
+ * @return Return 0 on success, or -1 on failure.
+ */
+static int startReader(InflateReader *reader, int fd, const AccessPoint *point, long long limit, AccessIndex *index)
+{
+    // A gzip header is only expected at the start of the file, while an access point is inside raw deflate data.
+    if (resetReader(reader, point != NULL ? -15 : 47) != 0)
+        return -1;
+    reader->fd = fd;
+    reader->limit = limit;
+    reader->index = index;
+    if (index != NULL && (reader->window = calloc(1, WINDOW_SIZE)) == NULL)
+        return -1;
+    if (point != NULL)
+    {
+        unsigned char byte = 0;
+        reader->raw = 1;
+        reader->in = point->in - (point->bits ? 1 : 0);
+        reader->out = point->out;
+        if (lseek(fd, reader->in, SEEK_SET) != reader->in || (point->bits && read(fd, &byte, 1) != 1))
+            goto FAIL;
+        reader->in = point->in;
+        if (point->bits)
+            inflatePrime(&reader->stream, point->bits, byte >> (8 - point->bits));
+        inflateSetDictionary(&reader->stream, point->window, WINDOW_SIZE);
+    }
+    else if (lseek(fd, 0, SEEK_SET) != 0)
+        goto FAIL;
+    return 0;
+    FAIL:
+    free(reader->window);
+    reader->window = NULL;
+    return -1;
+}
+/**
+ * @brief Start inflating a gzip file in memory from its beginning.
+ * @param[in,out] reader The reader, which has been allocated by `initReader()`.
+ * @param[in] data The content of the file.
+ * @param[in] size The size of the file.
+ * @return Return 0 on success, or -1 on failure.
+ */
+static int startMemoryReader(InflateReader *reader, const unsigned char *data, size_t size)
+{
+    if (resetReader(reader, 47) != 0)
+        return -1;
+    reader->data = data;
+    reader->size = size;
+    return 0;
+}
+/**
+ * @brief Start inflating a gzip file from one of its members.
+ * @param[in,out] reader The reader, which has been allocated by `initReader()`.
+ * @param[in] fd The gzip file, or -1 if it is in memory.
+ * @param[in] data The content of the file if it is in memory.
+ * @param[in] size The size of the file.
+ * @param[in] offset The offset of the gzip header of the member.
+ * @return Return 0 on success, or -1 on failure.
+ */
+static int startMemberReader(InflateReader *reader, int fd, const unsigned char *data, size_t size, long long offset)
+{
+    if (resetReader(reader, 47) != 0)
+        return -1;
+    reader->fd = fd;
+    reader->data = data;
+    reader->size = size;
+    reader->in = offset;
+    return fd == -1 || lseek(fd, offset, SEEK_SET) == offset ? 0 : -1;
+}
+/**
+ * @brief Stop inflating a file. The file itself isn't closed.
+ * @param[in,out] reader The reader.
+ */
+static void stopReader(InflateReader *reader)
+{
+    free(reader->window);
+    reader->window = NULL;
+#ifdef _WIN32
+    closeOverlapped(reader);
+#endif
+}
+/**
+ * @brief Give the inflate stream of a reader the next compressed bytes.
+ * @param[in,out] reader The reader, whose stream has no input left.
+ * @return Return the number of bytes, 0 at the end of the file, or -1 on failure.
+ */
+static long readInput(InflateReader *reader)
+{
+    long ret;
+    if (reader->data != NULL)
+    {
+        size_t rest = reader->size - reader->in;
+        // The stream counts its input in `unsigned int`.
+        ret = rest < (size_t)1 << 30 ? (long)rest : 1L << 30;
+        reader->stream.next_in = (unsigned char *)reader->data + reader->in;
+    }
+#ifdef _WIN32
+    // The file is reopened for overlapped reads at its first read, which a file left to `read()` never gets to.
+    else if (reader->ahead != NULL &&
+             (reader->file != NULL ||
+              (reader->file = ReOpenFile((HANDLE)_get_osfhandle(reader->fd), GENERIC_READ,
+                                         FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                         FILE_FLAG_OVERLAPPED | FILE_FLAG_SEQUENTIAL_SCAN)) != NULL) &&
+             reader->file != INVALID_HANDLE_VALUE)
+        ret = readOverlapped(reader);
+#endif
+    else if ((ret = read(reader->fd, reader->input, INPUT_SIZE)) > 0)
+        reader->stream.next_in = reader->input;
+    if (ret > 0)
+    {
+        reader->in += ret;
+        reader->stream.avail_in = ret;
+    }
+    return ret;
+}
+/**
+ * @brief Record the current position of a reader that is at the end of a deflate block as an access point.
+ * @param[in,out] reader The reader.
+ * @return Return 0 on success, or -1 on failure.
+ */
+static int addAccessPoint(InflateReader *reader)
+{
+    AccessIndex *index = reader->index;
+    if (index->count == index->capacity)
+    {
+        size_t capacity = index->capacity > 0 ? index->capacity * 2 : 16;
+        AccessPoint *points = realloc(index->points, capacity * sizeof(AccessPoint));
+        if (points == NULL)
+            return -1;
+        index->points = points, index->capacity = capacity;
+    }
+    AccessPoint *point = &index->points[index->count++];
+    point->out = reader->out;
+    point->in = reader->in - reader->stream.avail_in;
+    point->bits = reader->stream.data_type & 7;
+    size_t ring = reader->out % WINDOW_SIZE;
+    memcpy(point->window, reader->window + ring, WINDOW_SIZE - ring);
+    memcpy(point->window + WINDOW_SIZE - ring, reader->window, ring);
+    return 0;
+}
+/**
+ * @brief Move a reader to the next gzip member after the end of the current one.
+ * @param[in,out] reader The reader.
+ * @return Return 0 on success, or -1 on failure.
+ * @note Anything but a gzip header after a member ends the file, like trailing garbage does for `gzread()`.
+ */
+static int nextMember(InflateReader *reader)
+{
+    z_stream *stream = &reader->stream;
+    if (reader->raw)
+    {
+        // Raw inflating stops before the trailer of the member.
+        long long offset = reader->in - stream->avail_in + 8;
+        if (reader->data == NULL && lseek(reader->fd, offset, SEEK_SET) != offset)
+            return -1;
+        reader->in = offset;
+        stream->avail_in = 0;
+    }
+    if (stream->avail_in == 0 && readInput(reader) < 0)
+        return -1;
+    if (stream->avail_in == 0 || stream->next_in[0] != 0x1f || (stream->avail_in > 1 && stream->next_in[1] != 0x8b))
+    {
+        reader->done = 1;
+        return 0;
+    }
+    reader->raw = 0;
+    return inflateReset2(stream, 47) == Z_OK ? 0 : -1;
+}
+/**
+ * @brief Read decompressed data from a gzip file.
+ * @param[in,out] reader The reader.
+ * @param[out] buffer The buffer for outputting the data.
+ * @param[in] size The size of the buffer.
+ * @return Return the number of bytes read, 0 at the end, or -1 on failure.
+ * @note With a limit, the data ends at the first line feed at or after the limit.
+ */
+static long readInflate(InflateReader *reader, char *buffer, size_t size)
+{
+    z_stream *stream = &reader->stream;
+    size_t produced = 0;
+    while (!reader->done && produced < size)
+    {
+        long got;
+        if (stream->avail_in == 0 && (got = readInput(reader)) <= 0)
+        {
+            // A file that ends in the middle of a member is read up to there, like `gzread()` does.
+            reader->done = 1;
+            reader->error = got < 0;
+            break;
+        }
+        unsigned char *out = (unsigned char *)buffer + produced;
+        stream->next_out = out;
+        stream->avail_out = size - produced;
+        // Stopping at the end of each block lets an index record every block boundary it needs.
+        int ret = inflate(stream, reader->index != NULL ? Z_BLOCK : Z_NO_FLUSH);
+        size_t count = size - produced - stream->avail_out;
+        if (reader->window != NULL)
+            for (size_t i = 0; i < count;)
+            {
+                size_t ring = (reader->out + i) % WINDOW_SIZE;
+                size_t n = WINDOW_SIZE - ring < count - i ? WINDOW_SIZE - ring : count - i;
+                memcpy(reader->window + ring, out + i, n);
+                i += n;
+            }
+        if (reader->limit >= 0 && reader->out + (long long)count >= reader->limit)
+        {
+            long long from = reader->limit - 1 > reader->out ? reader->limit - 1 : reader->out;
+            unsigned char *newline = memchr(out + (from - reader->out), '\n', count - (from - reader->out));
+            if (newline != NULL)
+                count = newline + 1 - out, reader->done = 1;
+        }
+        reader->out += count;
+        produced += count;
+        if (ret == Z_STREAM_END)
+        {
+            if (nextMember(reader) != 0)
+                reader->done = reader->error = 1;
+        }
+        else if (ret != Z_OK && ret != Z_BUF_ERROR)
+            reader->done = reader->error = 1;
+        else if (reader->index != NULL && (stream->data_type & 128) && !(stream->data_type & 64) &&
+                 reader->out - (reader->index->count > 0 ? reader->index->points[reader->index->count - 1].out : 0) >=
+                     INDEX_SPAN &&
+                 addAccessPoint(reader) != 0)
+            reader->done = reader->error = 1;
+    }
+    return produced > 0 || !reader->error ? (long)produced : -1;
+}
+/**
+ * @brief Find the line feeds in part of a block of text one byte at a time.
+ * @param[in] data The text.
+ * @param[in] from The offset to start at.
+ * @param[in] size The size of the text.
+ * @param[in,out] offsets The offsets of the line feeds, which are appended to.
+ * @param[in] count The number of line feeds found so far.
+ * @param[in] max The most line feeds to find.
+ * @return Return the number of line feeds found in total.
+ */
+static inline size_t findNewlinesFrom(const char *data, size_t from, size_t size, size_t *offsets, size_t count,
+                                      size_t max)
+{
+    for (size_t i = from; i < size && count < max; i++)
+        if (data[i] == '\n')
+            offsets[count++] = i;
+    return count;
+}
+/**
+ * @brief Find the line feeds in a block of text one byte at a time.
+ * @param[in] data The text.
+ * @param[in] size The size of the text.
+ * @param[out] offsets The offsets of the line feeds.
+ * @param[in] max The most line feeds to find.
+ * @return Return the number of line feeds found.
+ */
+static size_t findNewlinesScalar(const char *data, size_t size, size_t *offsets, size_t max)
+{
+    return findNewlinesFrom(data, 0, size, offsets, 0, max);
+}
+#if defined(USE_SSE2) || defined(USE_NEON)
+/**
+ * @brief Get the index of the lowest set bit of a mask.
+ * @param[in] mask The mask, which mustn't be 0.
+ * @return Return the index.
+ */
+static inline int lowestBit(uint64_t mask)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return (int)index;
+#else
+    return __builtin_ctzll(mask);
+#endif
+}
+/**
+ * @brief Append the offsets of the line feeds in a mask with `step` bits per byte, returning once `max` are found.
+ */
+#define TAKE_NEWLINES(mask, step, base)                       \
+    for (; (mask) != 0; (mask) &= (mask) - 1)                 \
+    {                                                         \
+        offsets[count++] = (base) + lowestBit(mask) / (step); \
+        if (count == max)                                     \
+            return count;                                     \
+    }
+#endif
+#ifdef USE_SSE2
+/**
+ * @brief Find the line feeds in a block of text 16 bytes at a time with SSE2.
+ * @param[in] data The text.
+ * @param[in] size The size of the text.
+ * @param[out] offsets The offsets of the line feeds.
+ * @param[in] max The most line feeds to find.
+ * @return Return the number of line feeds found.
+ */
+static size_t findNewlinesSse2(const char *data, size_t size, size_t *offsets, size_t max)
+{
+    const __m128i newline = _mm_set1_epi8('\n');
+    size_t count = 0, i = 0;
+    if (max == 0)
+        return 0;
+    for (; i + 16 <= size; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(data + i));
+        uint64_t mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, newline));
+        TAKE_NEWLINES(mask, 1, i);
+    }
+    return findNewlinesFrom(data, i, size, offsets, count, max);
+}
+#endif
+#ifdef USE_AVX2
+/**
+ * @brief Find the line feeds in a block of text 64 bytes at a time with AVX2.
+ * @param[in] data The text.
+ * @param[in] size The size of the text.
+ * @param[out] offsets The offsets of the line feeds.
+ * @param[in] max The most line feeds to find.
+ * @return Return the number of line feeds found.
+ * @note Two vectors are compared per step, so that the mask of a step covers a typical line.
+ */
+TARGET_AVX2 static size_t findNewlinesAvx2(const char *data, size_t size, size_t *offsets, size_t max)
+{
+    const __m256i newline = _mm256_set1_epi8('\n');
+    size_t count = 0, i = 0;
+    if (max == 0)
+        return 0;
+    for (; i + 64 <= size; i += 64)
+    {
+        __m256i low = _mm256_loadu_si256((const __m256i *)(data + i));
+        __m256i high = _mm256_loadu_si256((const __m256i *)(data + i + 32));
+        uint64_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, newline)) |
+                        (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, newline)) << 32;
+        TAKE_NEWLINES(mask, 1, i);
+    }
+    return findNewlinesFrom(data, i, size, offsets, count, max);
+}
+/**
+ * @brief Determine whether the CPU and the operating system support AVX2.
+ * @return Return 1 on success, or 0 on failure.
+ */
+static int hasAvx2(void)
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    // AVX needs the operating system to save the upper halves of the registers, which XGETBV reports.
+    if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6)
+        return 0;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+#ifdef USE_NEON
+/**
+ * @brief Find the line feeds in a block of text 16 bytes at a time with NEON.
+ * @param[in] data The text.
+ * @param[in] size The size of the text.
+ * @param[out] offsets The offsets of the line feeds.
+ * @param[in] max The most line feeds to find.
+ * @return Return the number of line feeds found.
+ * @note NEON has no byte mask instruction, so each compared byte is narrowed to 4 bits of a 64-bit mask.
+ */
+static size_t findNewlinesNeon(const char *data, size_t size, size_t *offsets, size_t max)
+{
+    const uint8x16_t newline = vdupq_n_u8('\n');
+    size_t count = 0, i = 0;
+    if (max == 0)
+        return 0;
+    for (; i + 16 <= size; i += 16)
+    {
+        uint8x16_t equal = vceqq_u8(vld1q_u8((const uint8_t *)data + i), newline);
+        uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(equal), 4)), 0);
+        mask &= 0x8888888888888888ull;
+        TAKE_NEWLINES(mask, 4, i);
+    }
+    return findNewlinesFrom(data, i, size, offsets, count, max);
+}
+#endif
+#if defined(USE_SSE2) || defined(USE_NEON)
+#undef TAKE_NEWLINES
+#endif
+/** The kernel that finds line feeds, picked once for the CPU. */
+static size_t (*findNewlines)(const char *data, size_t size, size_t *offsets, size_t max) = findNewlinesScalar;
+/** The name of the kernel that finds line feeds. */
+static const char *newlineKernel = "scalar";
+/** The guard that picks the kernel once. */
+static pthread_once_t newlineKernelOnce = PTHREAD_ONCE_INIT;
+/**
+ * @brief Pick the fastest kernel that finds line feeds on this CPU.
+ * @note SSE2 is part of x86-64 and NEON of AArch64, so only AVX2 has to be detected at run time.
+ */
+static void pickNewlineKernel(void)
+{
+#if defined(USE_AVX2)
+    if (hasAvx2())
+    {
+        findNewlines = findNewlinesAvx2, newlineKernel = "avx2";
+        return;
+    }
+#endif
+#if defined(USE_SSE2)
+    findNewlines = findNewlinesSse2, newlineKernel = "sse2";
+#elif defined(USE_NEON)
+    findNewlines = findNewlinesNeon, newlineKernel = "neon";
+#endif
+}
+size_t mcFindNewlines(const char *data, size_t size, size_t *offsets, size_t max)
+{
+    pthread_once(&newlineKernelOnce, pickNewlineKernel);
+    return findNewlines(data, size, offsets, max);
+}
+const char *mcNewlineKernel(void)
+{
+    pthread_once(&newlineKernelOnce, pickNewlineKernel);
+    return newlineKernel;
+}
+/**
+ * @brief A scanner that reads a log file block by block and splits it into lines.
+ */
+typedef struct
+{
+    int fd;                 /**< The plain file being read, or -1. */
+    char *buffer;           /**< A buffer of `MC_SCAN_BUFFER_SIZE` bytes. */
+    size_t begin;           /**< The offset of the first unconsumed byte in the buffer. */
+    size_t end;             /**< The offset of the end of the valid data in the buffer. */
+    int skip;               /**< Whether the rest of an overlong line still has to be skipped. */
+    int eof;                /**< Whether the end of the file has been reached. */
+    int error;              /**< Whether a read error has occurred. */
+    InflateReader *reader;  /**< The reader to read a gzip file through instead of `fd`, or NULL. */
+    McStats *stats;         /**< The counters to add the time and the bytes of reading to. */
+    int timing;             /**< Whether the time of reading is measured. */
+} LineScanner;
+/**
+ * @brief Start scanning a log file that is read into a buffer.
+ * @param[out] scanner The scanner.
+ * @param[in] buffer A buffer of `MC_SCAN_BUFFER_SIZE` bytes.
+ * @param[in,out] stats The counters to add to.
+ * @param[in] timing Whether the time of reading is measured.
+ */
+static void startScanner(LineScanner *scanner, char *buffer, McStats *stats, int timing)
+{
+    memset(scanner, 0, sizeof(LineScanner));
+    scanner->fd = -1;
+    scanner->buffer = buffer;
+    scanner->stats = stats;
+    scanner->timing = timing;
+}
+/**
+ * @brief Get the next line from a log file.
+ * @param[in,out] scanner The scanner of the log file.
+ * @param[out] line A pointer for outputting the start of the line.
+ * @param[out] length A pointer for outputting the length of the line without the line feed.
+ * @return Return 0 on success, or 1 at the end of the file.
+ * @note A line longer than the buffer is truncated to its first `MC_SCAN_BUFFER_SIZE` bytes.
+ */
+static int scanLine(LineScanner *scanner, const char **line, size_t *length)
+{
+    for (;;)
+    {
+        char *begin = scanner->buffer + scanner->begin;
+        char *end = scanner->buffer + scanner->end;
+        char *newline = memchr(begin, '\n', end - begin);
+        if (newline != NULL)
+        {
+            scanner->begin = newline + 1 - scanner->buffer;
+            if (scanner->skip)
+            {
+                scanner->skip = 0;
+                continue;
+            }
+            *line = begin;
+            *length = newline - begin;
+            return 0;
+        }
+        if (scanner->eof)
+        {
+            if (scanner->skip || begin == end)
+                return 1;
+            scanner->begin = scanner->end;
+            *line = begin;
+            *length = end - begin;
+            return 0;
+        }
+        if (scanner->skip)
+            scanner->begin = scanner->end = 0;
+        else if (scanner->begin == 0 && scanner->end == MC_SCAN_BUFFER_SIZE)
+        {
+            scanner->skip = 1;
+            scanner->begin = scanner->end;
+            *line = begin;
+            *length = end - begin;
+            return 0;
+        }
+        else
+        {
+            memmove(scanner->buffer, begin, end - begin);
+            scanner->end -= scanner->begin;
+            scanner->begin = 0;
+        }
+        PHASE_CLOCK(clock);
+        PHASE_START(clock, scanner->timing, scanner->stats);
+        long ret = scanner->reader != NULL
+                       ? readInflate(scanner->reader, scanner->buffer + scanner->end, MC_SCAN_BUFFER_SIZE - scanner->end)
+                       : read(scanner->fd, scanner->buffer + scanner->end, MC_SCAN_BUFFER_SIZE - scanner->end);
+        PHASE_STOP(clock, scanner->timing, scanner->stats, MC_PHASE_INFLATE);
+        scanner->stats->decompressedBytes += ret > 0 ? ret : 0;
+        if (ret > 0)
+            scanner->end += ret;
+        else
+        {
+            scanner->eof = 1;
+            scanner->error = ret < 0;
+        }
+    }
+}
+/**
+ * @brief The formats of the timestamp at the start of a line, tried in this order when detecting the format of a file.
+ * @note Each entry gives the name, the template in which `0` stands for a digit, the offsets of the hour, minute and
+ * second, and the offset of an ISO date or -1 if there is none.
+ */
+#define LOG_FORMATS(X)                                          \
+    X(Vanilla, "[00:00:00]", 1, 4, 7, -1)                      \
+    X(Level, "[00:00:00 ", 1, 4, 7, -1)                        \
+    X(Proxy, "00:00:00 ", 0, 3, 6, -1)                         \
+    X(IsoBracket, "[0000-00-00 00:00:00", 12, 15, 18, 1)       \
+    X(Iso, "0000-00-00T00:00:00", 11, 14, 17, 0)               \
+    X(IsoSpace, "0000-00-00 00:00:00", 11, 14, 17, 0)
+/**
+ * @brief A format of the timestamp at the start of a line.
+ */
+typedef enum
+{
+#define FORMAT_ENUM(name, template, hour, minute, second, date) FORMAT_##name,
+    LOG_FORMATS(FORMAT_ENUM)
+#undef FORMAT_ENUM
+    FORMAT_COUNT,
+    FORMAT_UNKNOWN = -1
+} LogFormat;
+#define FORMAT_LENGTH(name, template, hour, minute, second, date) \
+    _Static_assert(sizeof(template) - 1 <= TAG_LENGTH, #name " is longer than TAG_LENGTH");
+LOG_FORMATS(FORMAT_LENGTH)
+#undef FORMAT_LENGTH
+/**
+ * @brief Determine whether a character is a decimal digit without depending on the locale.
+ */
+static inline int isDigit(char ch)
+{
+    return (unsigned)(ch - '0') < 10;
+}
+/**
+ * @brief Convert two validated digits to a number.
+ */
+static inline time_t readTwoDigits(const char *p)
+{
+    return (p[0] - '0') * 10 + (p[1] - '0');
+}
+/**
+ * @brief Convert a validated `yyyy-MM-dd` date to the number of days since 1970-01-01.
+ */
+static inline time_t readDate(const char *p)
+{
+    time_t year = readTwoDigits(p) * 100 + readTwoDigits(p + 2);
+    time_t month = readTwoDigits(p + 5), day = readTwoDigits(p + 8);
+    // Count the years from March so that the leap day is the last day of a year.
+    year -= month <= 2;
+    time_t era = year / 400, yoe = year - era * 400;
+    time_t doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    return era * 146097 + yoe * 365 + yoe / 4 - yoe / 100 + doy - 719468;
+}
+time_t mcGetDayNumber(const char *date)
+{
+    return readDate(date);
+}
+/**
+ * @brief Check the character at offset `i` of a line against a template, in which `0` stands for a digit.
+ * @note The template and the offset are constants, so each check folds into a single compare. Offsets past the end of
+ * the template always match.
+ */
+#define TAG_CHAR(template, i)                                                                          \
+    ((i) >= sizeof(template) - 1 || ((template)[(i) % sizeof(template)] == '0'                           \
+                                         ? isDigit(line[i])                                              \
+                                         : line[i] == (template)[(i) % sizeof(template)]))
+/**
+ * @brief Check all characters of a line against a template of up to `TAG_LENGTH` characters.
+ */
+#define TAG_CHARS(template)                                                                            \
+    (TAG_CHAR(template, 0) & TAG_CHAR(template, 1) & TAG_CHAR(template, 2) & TAG_CHAR(template, 3) &   \
+     TAG_CHAR(template, 4) & TAG_CHAR(template, 5) & TAG_CHAR(template, 6) & TAG_CHAR(template, 7) &   \
+     TAG_CHAR(template, 8) & TAG_CHAR(template, 9) & TAG_CHAR(template, 10) & TAG_CHAR(template, 11) & \
+     TAG_CHAR(template, 12) & TAG_CHAR(template, 13) & TAG_CHAR(template, 14) &                        \
+     TAG_CHAR(template, 15) & TAG_CHAR(template, 16) & TAG_CHAR(template, 17) &                        \
+     TAG_CHAR(template, 18) & TAG_CHAR(template, 19))
+/**
+ * @brief Define a function that matches one format with a fixed-width compare and digit checks.
+ */
+#define FORMAT_MATCHER(name, template, hour, minute, second, date)                                   \
+    static inline int match##name(const char *line, size_t length, time_t *time)                    \
+    {                                                                                                \
+        if (length < sizeof(template) - 1 || !TAG_CHARS(template))                                   \
+            return 1;                                                                                \
+        *time = (readTwoDigits(line + (hour)) * 60 + readTwoDigits(line + (minute))) * 60 +          \
+                readTwoDigits(line + (second));                                                      \
+        if ((date) >= 0)                                                                             \
+            *time += readDate(line + ((date) >= 0 ? (date) : 0)) * MC_DAY_SECONDS;                   \
+        return 0;                                                                                    \
+    }
+LOG_FORMATS(FORMAT_MATCHER)
+#undef FORMAT_MATCHER
+#if defined(USE_SSE2) || defined(USE_NEON)
+/** The number of bytes loaded at the start of a line by the vectorized matchers. */
+#define SIMD_WIDTH 16
+/** Expand `M(a, i)` for each offset `i` of a vector, separated by `op`. */
+#define SIMD_EACH(M, a, op)                                                                            \
+    M(a, 0) op M(a, 1) op M(a, 2) op M(a, 3) op M(a, 4) op M(a, 5) op M(a, 6) op M(a, 7) op M(a, 8)      \
+    op M(a, 9) op M(a, 10) op M(a, 11) op M(a, 12) op M(a, 13) op M(a, 14) op M(a, 15)
+#define SIMD_COMMA ,
+/** The character of a template at offset `i`, or 0 past its end. */
+#define TEMPLATE_AT(template, i) ((i) < sizeof(template) - 1 ? (template)[(i) % sizeof(template)] : 0)
+/** The bit of offset `i` if the template has a digit there. */
+#define DIGIT_BIT(template, i) ((TEMPLATE_AT(template, i) == '0') << (i))
+/** The bit of offset `i` if the template has another character there. */
+#define LITERAL_BIT(template, i) ((TEMPLATE_AT(template, i) != '0' && TEMPLATE_AT(template, i) != 0) << (i))
+/**
+ * @brief The weight of the digit at offset `i` in the number of minutes of a `hh:mm` time at `hour` and `minute`.
+ */
+#define MINUTE_WEIGHT(position, i)                                                                     \
+    ((i) == (position).hour       ? 600                                                                  \
+     : (i) == (position).hour + 1 ? 60                                                                   \
+     : (i) == (position).minute   ? 10                                                                   \
+     : (i) == (position).minute + 1 ? 1                                                                  \
+                                  : 0)
+/** The weight of the digit at offset `i` in the number of seconds of an `ss` time at `second`. */
+#define SECOND_WEIGHT(position, i) ((i) == (position).second ? 10 : (i) == (position).second + 1 ? 1 : 0)
+/**
+ * @brief The offsets of the time in a format, passed as one argument to the weight macros.
+ */
+typedef struct
+{
+    int hour, minute, second;
+} TimeOffsets;
+#endif
+#ifdef USE_SSE2
+/**
+ * @brief Add up the four 32-bit lanes of a vector.
+ */
+static inline int sumLanes(__m128i v)
+{
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(v);
+}
+/**
+ * @brief Define a function that matches one format on the first 16 bytes of a line with SSE2: one compare checks the
+ * literal characters, one unsigned range check covers all digits, and two multiply-adds convert the digits.
+ * @note Formats longer than 16 bytes or with a date use the scalar matcher.
+ */
+#define FORMAT_SIMD_MATCHER(name, template, hour, minute, second, date)                                  \
+    static inline int matchSimd##name(const char *line, size_t length, time_t *time)                    \
+    {                                                                                                    \
+        if (sizeof(template) - 1 > SIMD_WIDTH || (date) >= 0 || length < SIMD_WIDTH)                     \
+            return match##name(line, length, time);                                                      \
+        const TimeOffsets position = {hour, minute, second};                                             \
+        const int digits = SIMD_EACH(DIGIT_BIT, template, |), literals = SIMD_EACH(LITERAL_BIT, template, |); \
+        __m128i v = _mm_loadu_si128((const __m128i *)line);                                              \
+        __m128i d = _mm_sub_epi8(v, _mm_set1_epi8('0'));                                                 \
+        __m128i nine = _mm_set1_epi8(9);                                                                 \
+        int digitMask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(d, nine), nine));                  \
+        int literalMask = _mm_movemask_epi8(                                                             \
+            _mm_cmpeq_epi8(v, _mm_setr_epi8(SIMD_EACH((char)TEMPLATE_AT, template, SIMD_COMMA))));       \
+        if (((digitMask & digits) | (literalMask & literals)) != (digits | literals))                    \
+            return 1;                                                                                    \
+        __m128i zero = _mm_setzero_si128();                                                              \
+        __m128i low = _mm_unpacklo_epi8(d, zero), high = _mm_unpackhi_epi8(d, zero);                     \
+        __m128i minutes = _mm_add_epi32(                                                                 \
+            _mm_madd_epi16(low, _mm_setr_epi16(MINUTE_WEIGHT(position, 0), MINUTE_WEIGHT(position, 1),   \
+                                               MINUTE_WEIGHT(position, 2), MINUTE_WEIGHT(position, 3),   \
+                                               MINUTE_WEIGHT(position, 4), MINUTE_WEIGHT(position, 5),   \
+                                               MINUTE_WEIGHT(position, 6), MINUTE_WEIGHT(position, 7))), \
+            _mm_madd_epi16(high, _mm_setr_epi16(MINUTE_WEIGHT(position, 8), MINUTE_WEIGHT(position, 9),  \
+                                                MINUTE_WEIGHT(position, 10), MINUTE_WEIGHT(position, 11),\
+                                                MINUTE_WEIGHT(position, 12), MINUTE_WEIGHT(position, 13),\
+                                                MINUTE_WEIGHT(position, 14), MINUTE_WEIGHT(position, 15))));\
+        __m128i seconds = _mm_add_epi32(                                                                 \
+            _mm_madd_epi16(low, _mm_setr_epi16(SECOND_WEIGHT(position, 0), SECOND_WEIGHT(position, 1),   \
+                                               SECOND_WEIGHT(position, 2), SECOND_WEIGHT(position, 3),   \
+                                               SECOND_WEIGHT(position, 4), SECOND_WEIGHT(position, 5),   \
+                                               SECOND_WEIGHT(position, 6), SECOND_WEIGHT(position, 7))), \
+            _mm_madd_epi16(high, _mm_setr_epi16(SECOND_WEIGHT(position, 8), SECOND_WEIGHT(position, 9),  \
+                                                SECOND_WEIGHT(position, 10), SECOND_WEIGHT(position, 11),\
+                                                SECOND_WEIGHT(position, 12), SECOND_WEIGHT(position, 13),\
+                                                SECOND_WEIGHT(position, 14), SECOND_WEIGHT(position, 15))));\
+        /* 60 * minutes + seconds, as SSE2 has no 32-bit multiply. */                                    \
+        *time = sumLanes(_mm_add_epi32(_mm_sub_epi32(_mm_slli_epi32(minutes, 6), _mm_slli_epi32(minutes, 2)), \
+                                       seconds));                                                        \
+        return 0;                                                                                        \
+    }
+LOG_FORMATS(FORMAT_SIMD_MATCHER)
+#undef FORMAT_SIMD_MATCHER
+#elif defined(USE_NEON)
+/**
+ * @brief Define a function that matches one format on the first 16 bytes of a line with NEON: one compare checks the
+ * literal characters, one unsigned range check covers all digits, and two multiply-adds convert the digits.
+ * @note Formats longer than 16 bytes or with a date use the scalar matcher.
+ */
+#define FORMAT_SIMD_MATCHER(name, template, hour, minute, second, date)                                  \
+    static inline int matchSimd##name(const char *line, size_t length, time_t *time)                    \
+    {                                                                                                    \
+        if (sizeof(template) - 1 > SIMD_WIDTH || (date) >= 0 || length < SIMD_WIDTH)                     \
+            return match##name(line, length, time);                                                      \
+        const TimeOffsets position = {hour, minute, second};                                             \
+        const uint8_t literal[] = {SIMD_EACH(TEMPLATE_AT, template, SIMD_COMMA)};                        \
+        const uint8_t digitLane[] = {SIMD_EACH(0xFF * !!DIGIT_BIT, template, SIMD_COMMA)};               \
+        const uint8_t literalLane[] = {SIMD_EACH(0xFF * !!LITERAL_BIT, template, SIMD_COMMA)};           \
+        const uint16_t minuteWeight[] = {SIMD_EACH(MINUTE_WEIGHT, position, SIMD_COMMA)};                \
+        const uint16_t secondWeight[] = {SIMD_EACH(SECOND_WEIGHT, position, SIMD_COMMA)};                \
+        uint8x16_t v = vld1q_u8((const uint8_t *)line);                                                  \
+        uint8x16_t d = vsubq_u8(v, vdupq_n_u8('0'));                                                     \
+        uint8x16_t digitLanes = vld1q_u8(digitLane), literalLanes = vld1q_u8(literalLane);               \
+        uint8x16_t ok = vorrq_u8(vandq_u8(vcleq_u8(d, vdupq_n_u8(9)), digitLanes),                       \
+                                 vandq_u8(vceqq_u8(v, vld1q_u8(literal)), literalLanes));                \
+        if (vminvq_u8(vornq_u8(ok, vorrq_u8(digitLanes, literalLanes))) != 0xFF)                         \
+            return 1;                                                                                    \
+        uint16x8_t low = vmovl_u8(vget_low_u8(d)), high = vmovl_high_u8(d);                              \
+        uint16x8_t minutes = vmlaq_u16(vmulq_u16(low, vld1q_u16(minuteWeight)), high,                    \
+                                       vld1q_u16(minuteWeight + 8));                                     \
+        uint16x8_t seconds = vmlaq_u16(vmulq_u16(low, vld1q_u16(secondWeight)), high,                    \
+                                       vld1q_u16(secondWeight + 8));                                     \
+        *time = (time_t)vaddvq_u16(minutes) * 60 + vaddvq_u16(seconds);                                  \
+        return 0;                                                                                        \
+    }
+LOG_FORMATS(FORMAT_SIMD_MATCHER)
+#undef FORMAT_SIMD_MATCHER
+#endif
+/**
+ * @brief Extract a time by parsing the timestamp at the start of a line in a log file.
+ * @param[in] format The format of the log file.
+ * @param[in] line The start of the line.
+ * @param[in] length The length of the line.
+ * @param[out] time A `time_t` pointer for outputting time. A format with a date gives the seconds since the epoch.
+ * @return Return 0 on success, or 1 on failure.
+ */
+static inline int parseLine(LogFormat format, const char *line, size_t length, time_t *time)
+{
+    switch (format)
+    {
+#if defined(USE_SSE2) || defined(USE_NEON)
+#define FORMAT_CASE(name, template, hour, minute, second, date) \
+    case FORMAT_##name:                                          \
+        return matchSimd##name(line, length, time);
+#else
+#define FORMAT_CASE(name, template, hour, minute, second, date) \
+    case FORMAT_##name:                                          \
+        return match##name(line, length, time);
+#endif
+        LOG_FORMATS(FORMAT_CASE)
+#undef FORMAT_CASE
+    default:
+        return 1;
+    }
+}
+/** The largest number of lines validated in one batch. */
+#define LINE_BATCH 16
+/**
+ * @brief A batch of complete lines found by one newline scan.
+ */
+typedef struct
+{
+    const char *line[LINE_BATCH];  /**< The starts of the lines. */
+    size_t length[LINE_BATCH];     /**< The lengths of the lines. */
+    time_t time[LINE_BATCH];       /**< The times of the lines that have a timestamp. */
+    size_t count;                  /**< The number of lines. */
+} LineBatch;
+/**
+ * @brief Extract the times of a batch of lines.
+ * @param[in] format The format of the log file.
+ * @param[in,out] batch The lines, whose times are filled in.
+ * @param[in] first The index of the first line to parse.
+ * @return Return a mask with the bit of each line that has a timestamp set.
+ * @note The format is dispatched once per batch, so the loop is a run of independent fixed-width checks.
+ */
+static unsigned parseLineBatch(LogFormat format, LineBatch *batch, size_t first)
+{
+    unsigned stamped = 0;
+    switch (format)
+    {
+#if defined(USE_SSE2) || defined(USE_NEON)
+#define FORMAT_CASE(name, template, hour, minute, second, date)                                   \
+    case FORMAT_##name:                                                                           \
+        for (size_t i = first; i < batch->count; i++)                                             \
+            stamped |= (unsigned)(matchSimd##name(batch->line[i], batch->length[i], &batch->time[i]) == 0) << i; \
+        break;
+#else
+#define FORMAT_CASE(name, template, hour, minute, second, date)                                   \
+    case FORMAT_##name:                                                                           \
+        for (size_t i = first; i < batch->count; i++)                                             \
+            stamped |= (unsigned)(match##name(batch->line[i], batch->length[i], &batch->time[i]) == 0) << i; \
+        break;
+#endif
+        LOG_FORMATS(FORMAT_CASE)
+#undef FORMAT_CASE
+    default:
+        break;
+    }
+    return stamped;
+}
+/**
+ * @brief Get the next lines from a log file, taking as many complete lines as the buffer holds after the first one.
+ * @param[in,out] scanner The scanner of the log file.
+ * @param[out] batch The batch for outputting the lines.
+ * @return Return 0 on success, or 1 at the end of the file.
+ * @note The lines stay valid until the scanner is used again.
+ */
+static int scanLines(LineScanner *scanner, LineBatch *batch)
+{
+    batch->count = 0;
+    if (scanLine(scanner, &batch->line[0], &batch->length[0]) != 0)
+        return 1;
+    batch->count = 1;
+    if (scanner->skip)
+        return 0;
+    // The rest of the batch comes from one pass of the newline kernel over the buffer.
+    const char *begin = scanner->buffer + scanner->begin;
+    size_t offsets[LINE_BATCH - 1], found = findNewlines(begin, scanner->end - scanner->begin, offsets, LINE_BATCH - 1);
+    for (size_t i = 0, start = 0; i < found; start = offsets[i++] + 1)
+    {
+        batch->line[batch->count] = begin + start;
+        batch->length[batch->count++] = offsets[i] - start;
+    }
+    if (found > 0)
+        scanner->begin += offsets[found - 1] + 1;
+    return 0;
+}
+/** The number of lines at the start of a file in which its format is detected, after which it is assumed vanilla. */
+#define DETECT_LINES 256
+/**
+ * @brief Detect the format of a log file from one of its first lines.
+ * @param[in] line The start of the line.
+ * @param[in] length The length of the line.
+ * @param[out] time A `time_t` pointer for outputting the time of the line.
+ * @return Return the first format the line matches, or `FORMAT_UNKNOWN` if there is none.
+ */
+static LogFormat detectFormat(const char *line, size_t length, time_t *time)
+{
+    for (int format = 0; format < FORMAT_COUNT; format++)
+        if (parseLine(format, line, length, time) == 0)
+            return format;
+    return FORMAT_UNKNOWN;
+}
+/**
+ * @brief Find the last timestamp of an uncompressed log file by scanning backwards from its end.
+ * @param[in,out] scanner The scanner of the file, whose buffer is overwritten.
+ * @param[in] limit The offset before which no line is considered.
+ * @param[in] size The size of the file.
+ * @param[in] format The format of the file.
+ * @param[out] time A `time_t` pointer for outputting time.
+ * @return Return 0 on success, 1 on system failure, or 2 if no line after `limit` has a timestamp.
+ */
+static int scanTail(LineScanner *scanner, long long limit, long long size, LogFormat format, time_t *time)
+{
+    const long long block = MC_SCAN_BUFFER_SIZE - TAG_LENGTH - 1;
+    char *buffer = scanner->buffer;
+    PHASE_CLOCK(clock);
+    for (long long hi = size; hi > limit;)
+    {
+        long long lo = hi - limit > block ? hi - block : limit;
+        // Read one byte before the block to see whether it starts a line, and enough bytes after it to hold a tag.
+        long long from = lo > 0 ? lo - 1 : 0;
+        long long to = size - hi > TAG_LENGTH ? hi + TAG_LENGTH : size;
+        PHASE_START(clock, scanner->timing, scanner->stats);
+        int ret = lseek(scanner->fd, from, SEEK_SET) != from || read(scanner->fd, buffer, to - from) != to - from;
+        PHASE_STOP(clock, scanner->timing, scanner->stats, MC_PHASE_INFLATE);
+        scanner->stats->decompressedBytes += to - from;
+        if (ret)
+            return 1;
+        const char *begin = buffer + (lo - from), *end = buffer + (hi - from), *last = buffer + (to - from);
+        const char *p = lo == 0 || begin[-1] == '\n' ? begin : NULL;
+        int found = 0;
+        time_t tmp;
+        for (;;)
+        {
+            if (p != NULL && parseLine(format, p, last - p, &tmp) == 0)
+                *time = tmp, found = 1;
+            scanner->stats->lines += p != NULL;
+            const char *next = p != NULL ? p : begin;
+            const char *newline = memchr(next, '\n', end - next);
+            if (newline == NULL || newline + 1 == end)
+                break;
+            p = newline + 1;
+        }
+        if (found)
+            return 0;
+        hi = lo;
+    }
+    return 2;
+}
+#ifdef USE_LIBDEFLATE
+/** The size of the largest compressed file that is decompressed in one piece instead of being streamed. */
+#define WHOLE_FILE_LIMIT (4 * 1024 * 1024)
+/**
+ * @brief The buffers for decompressing whole files.
+ */
+typedef struct
+{
+    struct libdeflate_decompressor *decompressor;  /**< The decompressor, or NULL if it hasn't been allocated. */
+    unsigned char *input;                          /**< The compressed file. */
+    size_t inputSize;                              /**< The size of `input`. */
+    char *output;                                  /**< The decompressed file. */
+    size_t outputSize;                             /**< The size of `output`. */
+    size_t limit;                                  /**< The most bytes both buffers may take, or 0 for no limit. */
+} WholeFileBuffers;
+/**
+ * @brief Make sure that a buffer has at least a given size.
+ * @param[in,out] buffer The buffer, which is reallocated if it is too small.
+ * @param[in,out] size The size of the buffer.
+ * @param[in] needed The needed size.
+ * @return Return 0 on success, or -1 on failure.
+ */
+static int reserveBuffer(void **buffer, size_t *size, size_t needed)
+{
+    if (*size >= needed)
+        return 0;
+    void *tmp = realloc(*buffer, needed);
+    if (tmp == NULL)
+        return -1;
+    *buffer = tmp, *size = needed;
+    return 0;
+}
+/**
+ * @brief Make sure that the output buffer for decompressing whole files has at least a given size within the limit.
+ * @param[in,out] whole The buffers.
+ * @param[in] needed The needed size.
+ * @return Return 0 on success, or -1 on failure or if the buffers would exceed their limit.
+ * @note A file whose decompressed content doesn't fit in the limit is streamed instead.
+ */
+static int reserveOutput(WholeFileBuffers *whole, size_t needed)
+{
+    if (whole->limit > 0 && (whole->inputSize > whole->limit || needed > whole->limit - whole->inputSize))
+        return -1;
+    return reserveBuffer((void **)&whole->output, &whole->outputSize, needed);
+}
+/**
+ * @brief Free the buffers for decompressing whole files.
+ * @param[in,out] whole The buffers.
+ */
+static void freeWholeFileBuffers(WholeFileBuffers *whole)
+{
+    if (whole->decompressor != NULL)
+        libdeflate_free_decompressor(whole->decompressor);
+    free(whole->input);
+    free(whole->output);
+    memset(whole, 0, sizeof(WholeFileBuffers));
+}
+/**
+ * @brief Decompress a whole gzip file in memory with libdeflate for a scanner to read from memory.
+ * @param[in,out] whole The buffers for decompressing whole files.
+ * @param[in] input The content of the file.
+ * @param[in] size The size of the file.
+ * @param[out] scanner The scanner whose buffer is set to the decompressed file.
+ * @return Return 0 on success, or 1 if the file has to be streamed through zlib instead.
+ * @note The file may consist of several gzip members. The size of the last one stored in the trailer is only a hint.
+ */
+static int inflateBuffer(WholeFileBuffers *whole, const unsigned char *input, size_t size, LineScanner *scanner)
+{
+    if (size < 18 || input[0] != 0x1f || input[1] != 0x8b)
+        return 1;
+    size_t hint = input[size - 4] | input[size - 3] << 8 | input[size - 2] << 16 | (size_t)input[size - 1] << 24;
+    if (whole->decompressor == NULL && (whole->decompressor = libdeflate_alloc_decompressor()) == NULL)
+        return 1;
+    if (reserveOutput(whole, (hint > 4 * size ? hint : 4 * size) + 1) != 0)
+        return 1;
+    size_t in = 0, out = 0;
+    while (in < size)
+    {
+        size_t used, produced;
+        enum libdeflate_result ret = libdeflate_gzip_decompress_ex(whole->decompressor, input + in, size - in,
+                                                                   whole->output + out, whole->outputSize - out,
+                                                                   &used, &produced);
+        if (ret == LIBDEFLATE_INSUFFICIENT_SPACE)
+        {
+            if (reserveOutput(whole, 2 * whole->outputSize) != 0)
+                return 1;
+            continue;
+        }
+        if (ret != LIBDEFLATE_SUCCESS)
+            return 1;
+        in += used, out += produced;
+    }
+    scanner->stats->decompressedBytes += out;
+    scanner->buffer = whole->output;
+    scanner->begin = 0;
+    scanner->end = out;
+    scanner->eof = 1;
+    return 0;
+}
+/**
+ * @brief Decompress a whole gzip file with libdeflate for a scanner to read from memory.
+ * @param[in,out] whole The buffers for decompressing whole files.
+ * @param[in] fd The file descriptor of the file positioned at its start.
+ * @param[in] size The size of the file.
+ * @param[out] scanner The scanner whose buffer is set to the decompressed file.
+ * @return Return 0 on success, or 1 if the file has to be streamed through zlib instead.
+ */
+static int inflateWhole(WholeFileBuffers *whole, int fd, size_t size, LineScanner *scanner)
+{
+    if (size < 18 || (whole->limit > 0 && size > whole->limit) ||
+        reserveBuffer((void **)&whole->input, &whole->inputSize, size) != 0)
+        return 1;
+    for (size_t done = 0; done < size;)
+    {
+        long ret = read(fd, whole->input + done, size - done);
+        if (ret <= 0)
+            return 1;
+        done += ret;
+    }
+    return inflateBuffer(whole, whole->input, size, scanner);
+}
+#endif
+/**
+ * @brief A read-only memory mapping of a whole file.
+ */
+typedef struct
+{
+    const char *data;  /**< The content of the file. */
+    size_t size;       /**< The size of the file. */
+#ifdef _WIN32
+    HANDLE mapping;    /**< The file mapping object. */
+#endif
+} FileMapping;
+/**
+ * @brief Map a whole file into memory.
+ * @param[in] fd The file descriptor of the file.
+ * @param[in] size The size of the file, which mustn't be 0.
+ * @param[out] mapping The mapping.
+ * @return Return 0 on success, or -1 on failure.
+ */
+static int mapFile(int fd, size_t size, FileMapping *mapping)
+{
+    mapping->size = size;
+#ifdef _WIN32
+    HANDLE file = (HANDLE)_get_osfhandle(fd);
+    if (file == INVALID_HANDLE_VALUE || (mapping->mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL)) == NULL)
+        return -1;
+    if ((mapping->data = MapViewOfFile(mapping->mapping, FILE_MAP_READ, 0, 0, size)) == NULL)
+    {
+        CloseHandle(mapping->mapping);
+        return -1;
+    }
+#else
+    void *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED)
+        return -1;
+    mapping->data = data;
+#endif
+    return 0;
+}
+/**
+ * @brief Unmap a file mapped by `mapFile()`.
+ * @param[in] mapping The mapping.
+ */
+static void unmapFile(FileMapping *mapping)
+{
+#ifdef _WIN32
+    UnmapViewOfFile(mapping->data);
+    CloseHandle(mapping->mapping);
+#else
+    munmap((void *)mapping->data, mapping->size);
+#endif
+}
+/**
+ * @brief Find the last timestamp of a log file in memory by walking backwards from its end.
+ * @param[in] data The content of the log file.
+ * @param[in] limit The offset before which no line is considered.
+ * @param[in] size The size of the log file.
+ * @param[in] format The format of the log file.
+ * @param[out] time A `time_t` pointer for outputting time.
+ * @return Return 0 on success, or 1 if no line after `limit` has a timestamp.
+ */
+static int findLastLine(const char *data, size_t limit, size_t size, LogFormat format, time_t *time)
+{
+    for (size_t p = size; p > limit;)
+    {
+        size_t line = p - 1;
+        while (line > limit && data[line - 1] != '\n')
+            line--;
+        if ((line == 0 || data[line - 1] == '\n') && parseLine(format, data + line, size - line, time) == 0)
+            return 0;
+        p = line;
+    }
+    return 1;
+}
+/**
+ * @brief Start splitting a log file into sessions.
+ * @param[out] engine The session engine.
+ * @param[in] options The options.
+ */
+void mcStartSessions(McSessions *engine, const McOptions *options)
+{
+    memset(engine, 0, sizeof(McSessions));
+    engine->options = options;
+    engine->format = FORMAT_UNKNOWN;
+    // Without join markers, a session is open from the first line on.
+    engine->active = options->joinMarkerCount == 0;
+}
+/**
+ * @brief Continue splitting a log file into sessions from a previous result.
+ * @param[out] engine The session engine.
+ * @param[in] options The options.
+ * @param[in] summary The result of the lines so far.
+ */
+void mcResumeSessions(McSessions *engine, const McOptions *options, const McSummary *summary)
+{
+    engine->options = options;
+    engine->format = FORMAT_UNKNOWN;
+    engine->detected = 0;
+    engine->found = 1;
+    engine->active = summary->active;
+    engine->first = summary->start;
+    engine->last = summary->end;
+    engine->time = summary->time;
+    engine->days = summary->days;
+    engine->sessions = summary->sessions;
+    engine->histogram = summary->histogram;
+}
+/**
+ * @brief Get the day of a timestamp, counted from the day of 1970-01-01 or from the first day of a log file.
+ * @param[in] time The timestamp.
+ * @return Return the day.
+ */
+static inline time_t getDay(time_t time)
+{
+    return (time >= 0 ? time : time - MC_DAY_SECONDS + 1) / MC_DAY_SECONDS;
+}
+/**
+ * @brief Count playtime in a histogram.
+ * @param[in,out] histogram The histogram.
+ * @param[in] first The first timestamp of the log file, whose day is the first one of the histogram.
+ * @param[in] from The time the playtime starts at, with the midnights passed added as `last + days * MC_DAY_SECONDS`.
+ * @param[in] delta The playtime.
+ * @note The playtime is split at every full hour it crosses, which is a single step for the usual gaps of seconds.
+ */
+static void addHistogram(McHistogram *histogram, time_t first, time_t from, time_t delta)
+{
+    time_t base = getDay(first);
+    while (delta > 0)
+    {
+        time_t day = getDay(from), second = from - day * MC_DAY_SECONDS, offset = day - base;
+        time_t step = HOUR_SECONDS - second % HOUR_SECONDS;
+        if (step > delta)
+            step = delta;
+        histogram->days[offset < 0 ? 0 : offset < MC_HISTOGRAM_DAYS ? offset : MC_HISTOGRAM_DAYS - 1] += step;
+        histogram->hours[second / HOUR_SECONDS] += step;
+        from += step, delta -= step;
+    }
+}
+/**
+ * @brief Add a histogram of a later part of a log file to that of an earlier part.
+ * @param[in,out] histogram The histogram of the earlier part.
+ * @param[in] next The histogram of the later part.
+ * @param[in] shift The day of the earlier part that the later part starts on.
+ */
+static void mergeHistogram(McHistogram *histogram, const McHistogram *next, time_t shift)
+{
+    for (int i = 0; i < MC_HISTOGRAM_DAYS; i++)
+        histogram->days[shift + i < MC_HISTOGRAM_DAYS ? shift + i : MC_HISTOGRAM_DAYS - 1] += next->days[i];
+    for (int i = 0; i < 24; i++)
+        histogram->hours[i] += next->hours[i];
+}
+/**
+ * @brief Feed a timestamp to the session engine.
+ * @param[in,out] engine The session engine.
+ * @param[in] time The timestamp.
+ * @note A timestamp more than half a day before the previous one means that midnight has passed. Smaller steps back
+ * come from lines logged out of order and are ignored.
+ */
+static void addTimestamp(McSessions *engine, time_t time)
+{
+    if (!engine->found)
+    {
+        engine->found = 1;
+        engine->first = engine->last = time;
+        if (engine->sessions == 0)
+            engine->sessions = engine->active;
+        return;
+    }
+    time_t delta = time - engine->last, from = engine->last + (time_t)engine->days * MC_DAY_SECONDS;
+    if (delta < -MC_DAY_SECONDS / 2)
+        delta += MC_DAY_SECONDS, engine->days++;
+    else if (delta < 0)
+        return;
+    engine->last = time;
+    if (!engine->active)
+    {
+        // Without join markers, the next timestamp after a leave marker opens a new session.
+        if (engine->options->joinMarkerCount == 0)
+            engine->active = 1, engine->sessions++;
+    }
+    else if (engine->options->sessionGap > 0 && delta > engine->options->sessionGap)
+        engine->sessions++;
+    else
+    {
+        engine->time += delta;
+        addHistogram(&engine->histogram, engine->first, from, delta);
+    }
+}
+/**
+ * @brief Determine whether a line contains a text.
+ * @param[in] line The start of the line.
+ * @param[in] length The length of the line.
+ * @param[in] text The text to search.
+ * @return Return 1 if the line contains the text, or 0 otherwise.
+ */
+static int containsText(const char *line, size_t length, const char *text)
+{
+    size_t size = strlen(text);
+    for (const char *end = line + length; (size_t)(end - line) >= size; line++)
+    {
+        if ((line = memchr(line, text[0], end - line - size + 1)) == NULL)
+            return 0;
+        if (memcmp(line, text, size) == 0)
+            return 1;
+    }
+    return 0;
+}
+/**
+ * @brief Open or close a session at a line of a log file that contains a marker.
+ * @param[in,out] engine The session engine.
+ * @param[in] line The start of the line.
+ * @param[in] length The length of the line.
+ */
+static void addMarkers(McSessions *engine, const char *line, size_t length)
+{
+    const McOptions *options = engine->options;
+    for (int i = 0; i < options->leaveMarkerCount; i++)
+        if (containsText(line, length, options->leaveMarkers[i]))
+        {
+            engine->active = 0;
+            return;
+        }
+    for (int i = 0; !engine->active && i < options->joinMarkerCount; i++)
+        if (containsText(line, length, options->joinMarkers[i]))
+            engine->active = 1, engine->sessions++;
+}
+/**
+ * @brief Feed a line of a log file to the session engine.
+ * @param[in,out] engine The session engine.
+ * @param[in] line The start of the line.
+ * @param[in] length The length of the line.
+ * @return Return 1 if the line has a timestamp, or 0 otherwise.
+ */
+int mcAddLine(McSessions *engine, const char *line, size_t length)
+{
+    time_t time;
+    int stamped;
+    if (engine->format != FORMAT_UNKNOWN)
+        stamped = parseLine(engine->format, line, length, &time) == 0;
+    else if ((engine->format = detectFormat(line, length, &time)) != FORMAT_UNKNOWN)
+        stamped = 1;
+    else
+    {
+        if (++engine->detected == DETECT_LINES)
+            engine->format = FORMAT_Vanilla;
+        stamped = 0;
+    }
+    if (stamped)
+        addTimestamp(engine, time);
+    addMarkers(engine, line, length);
+    return stamped;
+}
+/**
+ * @brief Feed a batch of lines of a log file to the session engine.
+ * @param[in,out] engine The session engine.
+ * @param[in,out] batch The lines.
+ */
+static void addLineBatch(McSessions *engine, LineBatch *batch)
+{
+    size_t i = 0;
+    while (i < batch->count && engine->format == FORMAT_UNKNOWN)
+        mcAddLine(engine, batch->line[i], batch->length[i]), i++;
+    unsigned stamped = parseLineBatch(engine->format, batch, i);
+    for (; i < batch->count; i++)
+    {
+        if (stamped >> i & 1)
+            addTimestamp(engine, batch->time[i]);
+        if (engine->options->joinMarkerCount + engine->options->leaveMarkerCount > 0)
+            addMarkers(engine, batch->line[i], batch->length[i]);
+    }
+}
+/**
+ * @brief Get the result of the session engine.
+ * @param[in] engine The session engine.
+ * @param[out] summary The summary whose times are filled in.
+ */
+void mcFinishSessions(const McSessions *engine, McSummary *summary)
+{
+    summary->start = engine->first;
+    summary->end = engine->last;
+    summary->time = engine->time;
+    summary->days = engine->days;
+    summary->sessions = engine->sessions;
+    summary->active = engine->active;
+    summary->histogram = engine->histogram;
+}
+/**
+ * @brief Append the sessions of a later part of a log file to those of an earlier part.
+ * @param[in,out] engine The session engine of the earlier part.
+ * @param[in] next The session engine of the later part, which has started with an open session.
+ * @note Only valid without join or leave markers, as the later part can't know whether a session is open at its start.
+ */
+static void mergeSessions(McSessions *engine, const McSessions *next)
+{
+    if (!next->found)
+        return;
+    if (!engine->found)
+    {
+        int format = engine->format;
+        *engine = *next;
+        if (next->format == FORMAT_UNKNOWN)
+            engine->format = format;
+        return;
+    }
+    // The step between the two parts counts like any other and may start a new session.
+    addTimestamp(engine, next->first);
+    time_t shift = getDay(engine->last + (time_t)engine->days * MC_DAY_SECONDS) - getDay(engine->first);
+    mergeHistogram(&engine->histogram, &next->histogram, shift);
+    engine->time += next->time;
+    engine->days += next->days;
+    engine->sessions += next->sessions - 1;
+    engine->last = next->last;
+}
+/**
+ * @brief A parser of log files, which keeps its buffers from one file to the next.
+ */
+struct McParser
+{
+    McOptions options;       /**< The options. */
+    char *buffer;            /**< A buffer of `MC_SCAN_BUFFER_SIZE` bytes that log files are read into. */
+    InflateReader reader;    /**< The reader that gzip files are streamed through. */
+    McStats stats;           /**< The counters since they have last been collected. */
+#ifdef USE_LIBDEFLATE
+    WholeFileBuffers whole;  /**< The buffers for decompressing whole files. */
+#endif
+};
+/**
+ * @brief A number of threads shared by parsers.
+ */
+struct McThreadBudget
+{
+    atomic_int free;  /**< The number of threads that haven't been taken. */
+};
+McThreadBudget *mcCreateThreadBudget(int threads)
+{
+    McThreadBudget *budget = malloc(sizeof(McThreadBudget));
+    if (budget != NULL)
+        atomic_init(&budget->free, threads);
+    return budget;
+}
+void mcFreeThreadBudget(McThreadBudget *budget)
+{
+    free(budget);
+}
+int mcTakeThreads(McThreadBudget *budget, int wanted)
+{
+    int left = atomic_load(&budget->free), taken;
+    do
+        taken = left < wanted ? left : wanted;
+    while (taken > 0 && !atomic_compare_exchange_weak(&budget->free, &left, left - taken));
+    return taken > 0 ? taken : 0;
+}
+void mcReturnThreads(McThreadBudget *budget, int count)
+{
+    atomic_fetch_add(&budget->free, count);
+}
+void mcInitOptions(McOptions *options)
+{
+    memset(options, 0, sizeof(McOptions));
+    options->jobs = 1;
+}
+McParser *mcCreateParser(const McOptions *options)
+{
+    McParser *parser = calloc(1, sizeof(McParser));
+    if (parser == NULL)
+        return NULL;
+    parser->options = *options;
+    pthread_once(&newlineKernelOnce, pickNewlineKernel);
+    if ((parser->buffer = malloc(MC_SCAN_BUFFER_SIZE)) == NULL)
+    {
+        free(parser);
+        return NULL;
+    }
+    if (initReader(&parser->reader) != 0)
+    {
+        free(parser->buffer);
+        free(parser);
+        return NULL;
+    }
+#ifdef USE_LIBDEFLATE
+    parser->whole.limit = options->memoryLimit;
+#endif
+    return parser;
+}
+void mcFreeParser(McParser *parser)
+{
+    if (parser == NULL)
+        return;
+#ifdef USE_LIBDEFLATE
+    freeWholeFileBuffers(&parser->whole);
+#endif
+    freeReader(&parser->reader);
+    free(parser->buffer);
+    free(parser);
+}
+void mcCollectStats(McParser *parser, McStats *stats)
+{
+    for (int i = 0; i < MC_PHASE_COUNT; i++)
+    {
+        stats->wall[i] += parser->stats.wall[i];
+        stats->cpu[i] += parser->stats.cpu[i];
+    }
+    stats->lines += parser->stats.lines;
+    stats->compressedBytes += parser->stats.compressedBytes;
+    stats->decompressedBytes += parser->stats.decompressedBytes;
+    memset(&parser->stats, 0, sizeof(McStats));
+}
+/** The number of compressed bytes at the end of a gzip file in which the start of its last member is searched. */
+#define MEMBER_SEARCH_LIMIT (16 * 1024 * 1024)
+/**
+ * @brief Inflate a gzip file from one of its members to the end and find its last timestamp.
+ * @param[in,out] parser The parser, whose reader and buffer are overwritten.
+ * @param[in] fd The gzip file, or -1 if it is in memory.
+ * @param[in] data The content of the file if it is in memory.
+ * @param[in] size The size of the file.
+ * @param[in] offset The offset of what may be the gzip header of a member.
+ * @param[in] format The format of the file.
+ * @param[out] time A `time_t` pointer for outputting time.
+ * @param[out] bytes A pointer for outputting the number of bytes inflated.
+ * @return Return 0 on success, 1 on system failure, or 2 if there is no valid member there or it has no timestamp.
+ */
+static int scanMembers(McParser *parser, int fd, const unsigned char *data, size_t size, long long offset,
+                       LogFormat format, time_t *time, long long *bytes)
+{
+    LineScanner scanner;
+    startScanner(&scanner, parser->buffer, &parser->stats, parser->options.timing);
+    scanner.reader = &parser->reader;
+    if (startMemberReader(&parser->reader, fd, data, size, offset) != 0)
+        return 1;
+    const char *line;
+    size_t length;
+    time_t tmp;
+    int found = 0;
+    while (scanLine(&scanner, &line, &length) == 0)
+    {
+        parser->stats.lines++;
+        if (parseLine(format, line, length, &tmp) == 0)
+            *time = tmp, found = 1;
+    }
+    *bytes = parser->reader.out;
+    // A header found by chance inside compressed data fails to inflate, or at the latest its check value fails.
+    int ret = scanner.error ? 2 : found ? 0 : 2;
+    stopReader(&parser->reader);
+    return ret;
+}
+/**
+ * @brief Find the last timestamp of a gzip file that consists of several members by inflating only the last ones.
+ * @param[in,out] parser The parser, whose reader and buffer are overwritten.
+ * @param[in] fd The gzip file, or -1 if it is in memory.
+ * @param[in] data The content of the file if it is in memory.
+ * @param[in] size The size of the file.
+ * @param[in] format The format of the file.
+ * @param[out] time A `time_t` pointer for outputting time.
+ * @param[out] bytes A pointer for outputting the number of bytes inflated.
+ * @return Return 0 on success, 1 on system failure, or 2 if the file has to be inflated from its start.
+ * @note The headers of members are searched backwards from the end, so the first one that inflates to the end of the
+ * file with a timestamp belongs to the last member with a timestamp. A file of a single member always returns 2.
+ */
+static int scanLastMember(McParser *parser, int fd, const unsigned char *data, size_t size, LogFormat format,
+                          time_t *time, long long *bytes)
+{
+    const long long block = MC_SCAN_BUFFER_SIZE - 3;
+    long long hi = size, limit = size > MEMBER_SEARCH_LIMIT ? (long long)size - MEMBER_SEARCH_LIMIT : 1;
+    if (limit < 1)
+        limit = 1;
+    while (hi > limit)
+    {
+        long long lo = hi - limit > block ? hi - block : limit;
+        long long to = (long long)size - hi > 3 ? hi + 3 : (long long)size;
+        const unsigned char *p;
+        if (data != NULL)
+            p = data + lo;
+        else if (lseek(fd, lo, SEEK_SET) != lo || read(fd, parser->buffer, to - lo) != to - lo)
+            return 1;
+        else
+            p = (const unsigned char *)parser->buffer;
+        long long next = lo;
+        // A gzip header starts with the magic, the deflate method and flags whose reserved bits are clear.
+        for (long long i = (to - 4 < hi - 1 ? to - 4 : hi - 1) - lo; i >= 0; i--)
+            if (p[i] == 0x1f && p[i + 1] == 0x8b && p[i + 2] == 8 && (p[i + 3] & 0xe0) == 0)
+            {
+                int ret = scanMembers(parser, fd, data, size, lo + i, format, time, bytes);
+                if (ret != 2)
+                    return ret;
+                // The buffer has been overwritten, so the search goes on from a fresh read.
+                next = lo + i;
+                break;
+            }
+        hi = next;
+    }
+    return 2;
+}
+/**
+ * @brief Parse a log file that is open or in memory.
+ * @param[in,out] parser The parser.
+ * @param[in] fd The log file, or -1 if it is in memory.
+ * @param[in] data The content of the log file if it is in memory.
+ * @param[in] size The size of the log file.
+ * @param[out] summary The times recorded by the log file.
+ * @return Return 0 on success, 1 on system failure, or 2 on parsing failure.
+ */
+static int parseLog(McParser *parser, int fd, const unsigned char *data, size_t size, McSummary *summary)
+{
+    const McOptions *options = &parser->options;
+    McStats *stats = &parser->stats;
+    PHASE_CLOCK(clock);
+    PHASE_START(clock, options->timing, stats);
+    int gzip;
+    if (data == NULL)
+    {
+        unsigned char magic[2] = {0, 0};
+        gzip = read(fd, magic, 2) == 2 && magic[0] == 0x1f && magic[1] == 0x8b;
+        if (lseek(fd, 0, SEEK_SET) != 0)
+            return 1;
+    }
+    else
+        gzip = size >= 2 && data[0] == 0x1f && data[1] == 0x8b;
+    LineScanner scanner;
+    startScanner(&scanner, parser->buffer, stats, options->timing);
+    FileMapping mapping = {NULL, 0};
+    // An uncompressed log is scanned in place instead of being copied into the buffer, unless mapping it as a whole
+    // would exceed the memory limit.
+    if (!gzip && data != NULL)
+        mapping.data = (const char *)data, mapping.size = size;
+    else if (!gzip && size > 0 && (options->memoryLimit == 0 || size <= options->memoryLimit) &&
+             mapFile(fd, size, &mapping) != 0)
+        mapping.data = NULL;
+    if (mapping.data != NULL)
+    {
+        scanner.buffer = (char *)mapping.data;
+        scanner.end = mapping.size;
+        scanner.eof = 1;
+    }
+    PHASE_STOP(clock, options->timing, stats, MC_PHASE_OPEN);
+    // Taking the end time from the tail skips the middle, so it can neither split sessions nor see several midnights.
+    int tail = options->tailSeek && options->sessionGap == 0 && options->joinMarkerCount == 0 &&
+               options->leaveMarkerCount == 0;
+#ifdef USE_LIBDEFLATE
+    // Small rotated logs are cheaper to decompress in one piece than to stream, unless only their ends are needed.
+    PHASE_START(clock, options->timing, stats);
+    if (gzip && !tail && size <= WHOLE_FILE_LIMIT &&
+        (data != NULL ? inflateBuffer(&parser->whole, data, size, &scanner)
+                      : inflateWhole(&parser->whole, fd, size, &scanner)) != 0 &&
+        fd != -1 && lseek(fd, 0, SEEK_SET) != 0)
+        return 1;
+    PHASE_STOP(clock, options->timing, stats, MC_PHASE_INFLATE);
+#endif
+    if (!scanner.eof && gzip)
+    {
+        if ((data != NULL ? startMemoryReader(&parser->reader, data, size)
+                          : startReader(&parser->reader, fd, NULL, -1, NULL)) != 0)
+            return 1;
+        scanner.reader = &parser->reader;
+    }
+    else if (!scanner.eof)
+        scanner.fd = fd;
+    PHASE_START(clock, options->timing, stats);
+    const char *line;
+    size_t length;
+    time_t tmp;
+    McSessions engine;
+    mcStartSessions(&engine, options);
+    long long lines = 0, bytes = -1;
+    while (tail && !engine.found && scanLine(&scanner, &line, &length) == 0)
+        mcAddLine(&engine, line, length), lines++;
+    if (tail && engine.found && mapping.data != NULL)
+    {
+        // Only the tail of a mapped log has to be touched for the end time.
+        if (findLastLine(mapping.data, scanner.begin, mapping.size, engine.format, &tmp) == 0)
+            addTimestamp(&engine, tmp);
+        stats->decompressedBytes += scanner.begin;
+    }
+    else if (tail && engine.found && scanner.fd != -1)
+    {
+        // An uncompressed file can be seeked, so only its tail has to be read for the end time.
+        switch (scanTail(&scanner, lseek(fd, 0, SEEK_CUR) - (scanner.end - scanner.begin), size, engine.format, &tmp))
+        {
+        case 0:
+            addTimestamp(&engine, tmp);
+            break;
+        case 1:
+            scanner.error = 1;
+        }
+    }
+    else if (tail && engine.found && scanner.reader != NULL && !parser->reader.done)
+    {
+        // Only the last members of a gzip file made of several have to be inflated for the end time.
+        long long head = parser->reader.out;
+        stopReader(&parser->reader);
+        switch (scanLastMember(parser, fd, data, size, engine.format, &tmp, &bytes))
+        {
+        case 0:
+            addTimestamp(&engine, tmp);
+            bytes += head;
+            break;
+        case 1:
+            scanner.error = 1;
+            break;
+        default:
+            // A single member has to be inflated in full after all.
+            bytes = -1;
+            startScanner(&scanner, parser->buffer, stats, options->timing);
+            if ((data != NULL ? startMemoryReader(&parser->reader, data, size)
+                              : startReader(&parser->reader, fd, NULL, -1, NULL)) != 0)
+            {
+                scanner.error = 1;
+                break;
+            }
+            scanner.reader = &parser->reader;
+            mcStartSessions(&engine, options);
+            LineBatch batch;
+            while (scanLines(&scanner, &batch) == 0)
+                addLineBatch(&engine, &batch), lines += batch.count;
+        }
+    }
+    else
+    {
+        LineBatch batch;
+        while (scanLines(&scanner, &batch) == 0)
+            addLineBatch(&engine, &batch), lines += batch.count;
+        if (mapping.data != NULL)
+            stats->decompressedBytes += mapping.size;
+    }
+    summary->bytes = bytes >= 0                ? bytes
+                     : scanner.reader != NULL ? parser->reader.out
+                     : scanner.fd != -1       ? (long long)size
+                                              : (long long)scanner.end;
+    if (mapping.data != NULL && fd != -1)
+        unmapFile(&mapping);
+    if (scanner.reader != NULL)
+        stopReader(&parser->reader);
+    PHASE_STOP(clock, options->timing, stats, MC_PHASE_SCAN);
+    stats->lines += lines;
+    stats->compressedBytes += size;
+    if (scanner.error)
+        return 1;
+    if (!engine.found)
+        return 2;
+    mcFinishSessions(&engine, summary);
+    return 0;
+}
+int mcParseFile(McParser *parser, const char *path, McSummary *summary)
+{
+    PHASE_CLOCK(clock);
+    PHASE_START(clock, parser->options.timing, &parser->stats);
+    struct stat status;
+    int fd = open(path, O_RDONLY | O_BINARY);
+    if (fd == -1)
+        return 1;
+    if (fstat(fd, &status) == -1)
+    {
+        close(fd);
+        return 1;
+    }
+    PHASE_STOP(clock, parser->options.timing, &parser->stats, MC_PHASE_OPEN);
+    int ret = parseLog(parser, fd, NULL, status.st_size, summary);
+    PHASE_START(clock, parser->options.timing, &parser->stats);
+    close(fd);
+    PHASE_STOP(clock, parser->options.timing, &parser->stats, MC_PHASE_OPEN);
+    return ret;
+}
+int mcParseBuffer(McParser *parser, const void *data, size_t size, McSummary *summary)
+{
+    return parseLog(parser, -1, data, size, summary);
+}
+/** The first line of an access point index file. */
+#define INDEX_MAGIC "mc-playtime-calc zran 1\n"
+/**
+ * @brief Load the access point index of a gzip file.
+ * @param[in] path The path to the index file.
+ * @param[in] stamp The version of the gzip file.
+ * @param[out] index The index.
+ * @return Return 0 on success, or -1 if there is no valid index for this version of the file.
+ * @note The points are stored in the native layout, as the index is only a cache of this machine.
+ */
+static int loadIndex(const char *path, const McFileStamp *stamp, AccessIndex *index)
+{
+    memset(index, 0, sizeof(AccessIndex));
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+        return -1;
+    char magic[sizeof(INDEX_MAGIC) - 1];
+    unsigned long long count;
+    int ret = -1;
+    if (fread(magic, sizeof(magic), 1, file) != 1 || memcmp(magic, INDEX_MAGIC, sizeof(magic)) != 0 ||
+        fread(&index->stamp, sizeof(McFileStamp), 1, file) != 1 ||
+        memcmp(&index->stamp, stamp, sizeof(McFileStamp)) != 0 ||
+        fread(&index->size, sizeof(long long), 1, file) != 1 || fread(&count, sizeof(count), 1, file) != 1 ||
+        count == 0 || count > SIZE_MAX / sizeof(AccessPoint) ||
+        (index->points = malloc(count * sizeof(AccessPoint))) == NULL)
+        goto END;
+    if (fread(index->points, sizeof(AccessPoint), count, file) != count)
+        goto END;
+    for (size_t i = 0; i < count; i++)
+    {
+        const AccessPoint *point = &index->points[i];
+        if (point->out <= (i > 0 ? point[-1].out : 0) || point->out >= index->size || point->in <= 0 ||
+            point->in > stamp->size || point->bits < 0 || point->bits > 7)
+            goto END;
+    }
+    index->count = index->capacity = count;
+    ret = 0;
+    END:
+    if (ret != 0)
+    {
+        free(index->points);
+        index->points = NULL;
+    }
+    fclose(file);
+    return ret;
+}
+/**
+ * @brief Save the access point index of a gzip file.
+ * @param[in] path The path to the index file, whose directory must exist.
+ * @param[in] index The index.
+ * @return Return 0 on success, or -1 on failure.
+ */
+static int saveIndex(const char *path, const AccessIndex *index)
+{
+    char *tmp = malloc(strlen(path) + 32);
+    if (tmp == NULL)
+        return -1;
+    sprintf(tmp, "%s.%ld.tmp", path, (long)getpid());
+    FILE *file = fopen(tmp, "wb");
+    if (file == NULL)
+    {
+        free(tmp);
+        return -1;
+    }
+    unsigned long long count = index->count;
+    fputs(INDEX_MAGIC, file);
+    fwrite(&index->stamp, sizeof(McFileStamp), 1, file);
+    fwrite(&index->size, sizeof(long long), 1, file);
+    fwrite(&count, sizeof(count), 1, file);
+    fwrite(index->points, sizeof(AccessPoint), index->count, file);
+    int ret = ferror(file) | fclose(file);
+#ifdef _WIN32
+    if (ret == 0)
+        remove(path);
+#endif
+    if (ret != 0 || rename(tmp, path) != 0)
+    {
+        remove(tmp);
+        ret = -1;
+    }
+    free(tmp);
+    return ret;
+}
+/**
+ * @brief Parse one chunk of a gzip file between two access points.
+ * @param[in,out] parser The parser of the current thread.
+ * @param[in] path The path to the gzip file.
+ * @param[in] index The index of the file.
+ * @param[in] chunk The number of the chunk. Chunk `i` starts at access point `i - 1`, or the start of the file.
+ * @param[in] head Whether to stop at the first timestamp.
+ * @param[out] engine The session engine of the lines starting in the chunk.
+ * @return Return 0 on success, or 1 on system failure.
+ */
+static int parseChunk(McParser *parser, const char *path, const AccessIndex *index, size_t chunk, int head,
+                      McSessions *engine)
+{
+    const AccessPoint *point = chunk > 0 ? &index->points[chunk - 1] : NULL;
+    LineScanner scanner;
+    startScanner(&scanner, parser->buffer, &parser->stats, parser->options.timing);
+    scanner.reader = &parser->reader;
+    PHASE_CLOCK(clock);
+    PHASE_START(clock, parser->options.timing, &parser->stats);
+    int fd = open(path, O_RDONLY | O_BINARY);
+    if (fd == -1)
+        return 1;
+    if (startReader(&parser->reader, fd, point, chunk < index->count ? index->points[chunk].out : -1, NULL) != 0)
+    {
+        close(fd);
+        return 1;
+    }
+    mcStartSessions(engine, &parser->options);
+    long long lines = 0;
+    const char *line;
+    size_t length;
+    // A line cut by the access point belongs to the previous chunk.
+    if (point != NULL && point->window[WINDOW_SIZE - 1] != '\n')
+        scanLine(&scanner, &line, &length);
+    LineBatch batch;
+    if (head)
+        while (!engine->found && scanLine(&scanner, &line, &length) == 0)
+            mcAddLine(engine, line, length), lines++;
+    else
+        while (scanLines(&scanner, &batch) == 0)
+            addLineBatch(engine, &batch), lines += batch.count;
+    stopReader(&parser->reader);
+    close(fd);
+    PHASE_STOP(clock, parser->options.timing, &parser->stats, MC_PHASE_SCAN);
+    parser->stats.lines += lines;
+    return scanner.error;
+}
+/**
+ * @brief The chunks of a gzip file shared by the threads parsing them.
+ */
+typedef struct
+{
+    const char *path;          /**< The path to the gzip file. */
+    const AccessIndex *index;  /**< The index of the file. */
+    McSessions *engines;       /**< The session engine of each chunk. */
+    int *status;               /**< The return value of `parseChunk()` for each chunk. */
+    size_t count;              /**< The number of chunks. */
+    atomic_size_t next;        /**< The number of the next chunk to be taken. */
+} ChunkQueue;
+/**
+ * @brief A thread parsing chunks from a queue with its own parser.
+ */
+typedef struct
+{
+    ChunkQueue *queue;  /**< The queue. */
+    McParser *parser;   /**< The parser of the thread. */
+    pthread_t thread;   /**< The thread. */
+} ChunkWorker;
+/**
+ * @brief Parse chunks from a queue until it is empty.
+ * @param[in,out] arg The `ChunkWorker`.
+ * @return Return NULL.
+ */
+static void *parseChunkWorker(void *arg)
+{
+    ChunkWorker *worker = arg;
+    ChunkQueue *queue = worker->queue;
+    size_t i;
+    while ((i = atomic_fetch_add(&queue->next, 1)) < queue->count)
+        queue->status[i] = parseChunk(worker->parser, queue->path, queue->index, i, 0, &queue->engines[i]);
+    return NULL;
+}
+/**
+ * @brief Parse a gzip file through its access point index.
+ * @param[in,out] parser The parser, whose counters also receive those of the other threads.
+ * @param[in] path The path to the gzip file.
+ * @param[in] index The index of the file.
+ * @param[out] engine The session engine of the whole file.
+ * @return Return 0 on success, or 1 on system failure.
+ * @note With tail seeking, only the first and the last chunks are parsed. Otherwise, the chunks are parsed on up to
+ * `jobs` threads, as far as the thread budget allows, and their sessions are merged in order.
+ */
+static int parseChunks(McParser *parser, const char *path, const AccessIndex *index, McSessions *engine)
+{
+    const McOptions *options = &parser->options;
+    size_t count = index->count + 1;
+    int ret = 0;
+    if (options->tailSeek && options->sessionGap == 0)
+    {
+        McSessions last;
+        if ((ret = parseChunk(parser, path, index, 0, 1, engine)) != 0 || !engine->found)
+            return ret;
+        for (size_t i = count - 1; i > 0 && ret == 0; i--)
+            if ((ret = parseChunk(parser, path, index, i, 0, &last)) == 0 && last.found)
+            {
+                addTimestamp(engine, last.last);
+                break;
+            }
+        return ret;
+    }
+    ChunkQueue queue = {path, index, malloc(count * sizeof(McSessions)), malloc(count * sizeof(int)), count, 0};
+    size_t threads = options->jobs > 1 ? (size_t)options->jobs < count ? (size_t)options->jobs : count : 1;
+    // The threads of other files being parsed at the same time are taken from the same budget.
+    if (options->threads != NULL && threads > 1)
+        threads = 1 + mcTakeThreads(options->threads, (int)threads - 1);
+    ChunkWorker *workers = calloc(threads, sizeof(ChunkWorker));
+    if (queue.engines == NULL || queue.status == NULL || workers == NULL)
+        ret = 1;
+    else
+    {
+        // The calling thread takes part with its own parser, while every other thread gets a parser of its own.
+        size_t created = 1;
+        workers[0].queue = &queue;
+        workers[0].parser = parser;
+        for (; created < threads; created++)
+        {
+            workers[created].queue = &queue;
+            if ((workers[created].parser = mcCreateParser(options)) == NULL)
+                break;
+            if (pthread_create(&workers[created].thread, NULL, parseChunkWorker, &workers[created]) != 0)
+            {
+                mcFreeParser(workers[created].parser);
+                break;
+            }
+        }
+        parseChunkWorker(&workers[0]);
+        for (size_t i = 1; i < created; i++)
+        {
+            pthread_join(workers[i].thread, NULL);
+            mcCollectStats(workers[i].parser, &parser->stats);
+            mcFreeParser(workers[i].parser);
+        }
+        mcStartSessions(engine, options);
+        for (size_t i = 0; i < count; i++)
+        {
+            ret |= queue.status[i];
+            mergeSessions(engine, &queue.engines[i]);
+        }
+    }
+    if (options->threads != NULL && threads > 1)
+        mcReturnThreads(options->threads, (int)threads - 1);
+    free(workers);
+    free(queue.status);
+    free(queue.engines);
+    return ret;
+}
+int mcParseIndexed(McParser *parser, const char *path, const char *indexPath, McSummary *summary)
+{
+    const McOptions *options = &parser->options;
+    PHASE_CLOCK(clock);
+    PHASE_START(clock, options->timing, &parser->stats);
+    int fd = open(path, O_RDONLY | O_BINARY);
+    if (fd == -1)
+        return 1;
+    struct stat status;
+    unsigned char magic[2] = {0, 0};
+    if (fstat(fd, &status) != 0 || read(fd, magic, 2) != 2 || magic[0] != 0x1f || magic[1] != 0x8b)
+    {
+        close(fd);
+        return -1;
+    }
+    McFileStamp stamp = {status.st_ino, status.st_size, status.st_mtime};
+    AccessIndex index;
+    McSessions engine;
+    int loaded = loadIndex(indexPath, &stamp, &index) == 0, ret;
+    PHASE_STOP(clock, options->timing, &parser->stats, MC_PHASE_OPEN);
+    if (loaded)
+    {
+        close(fd);
+        if ((options->jobs <= 1 && !options->tailSeek) || options->joinMarkerCount + options->leaveMarkerCount > 0)
+        {
+            free(index.points);
+            return -1;
+        }
+        ret = parseChunks(parser, path, &index, &engine);
+    }
+    else
+    {
+        LineScanner scanner;
+        startScanner(&scanner, parser->buffer, &parser->stats, options->timing);
+        scanner.reader = &parser->reader;
+        index.stamp = stamp;
+        if (startReader(&parser->reader, fd, NULL, -1, &index) != 0)
+        {
+            close(fd);
+            return 1;
+        }
+        PHASE_START(clock, options->timing, &parser->stats);
+        LineBatch batch;
+        mcStartSessions(&engine, options);
+        while (scanLines(&scanner, &batch) == 0)
+            addLineBatch(&engine, &batch), parser->stats.lines += batch.count;
+        index.size = parser->reader.out;
+        ret = scanner.error;
+        stopReader(&parser->reader);
+        close(fd);
+        PHASE_STOP(clock, options->timing, &parser->stats, MC_PHASE_SCAN);
+        if (ret == 0 && index.count > 0)
+            saveIndex(indexPath, &index);
+    }
+    parser->stats.compressedBytes += status.st_size;
+    summary->bytes = index.size;
+    free(index.points);
+    if (ret != 0)
+        return 1;
+    if (!engine.found)
+        return 2;
+    mcFinishSessions(&engine, summary);
+    return 0;
+}
@@ -0,0 +1,276 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2023 Happy_Arno
+/**
+ * @file mcplaytime.h
+ * @brief The library behind mc-playtime-calc: parsing minecraft logs into playtime without printing or exiting.
+ *
+ * A parser owns the buffers and the inflate state that it reuses for every file, so one parser per thread can parse
+ * any number of files without allocating. Parsers are not thread-safe, but separate parsers can be used at once.
+ */
+#ifndef MCPLAYTIME_H
+#define MCPLAYTIME_H
+#include <stddef.h>
+#include <time.h>
+#ifdef __cplusplus
+extern "C" {
+#endif
+/** The size of the buffer that a parser reads decompressed data into, which also suits other reads of log text. */
+#define MC_SCAN_BUFFER_SIZE (256 * 1024)
+/** The maximum number of join or leave markers. */
+#define MC_MAX_MARKERS 16
+/** The number of seconds in a day. */
+#define MC_DAY_SECONDS (24 * 60 * 60)
+/** A number of threads shared by parsers, so that together they don't run more threads than the CPUs can take. */
+typedef struct McThreadBudget McThreadBudget;
+/**
+ * @brief The options of parsing, which every parser copies when it is created.
+ */
+typedef struct
+{
+    time_t sessionGap;                          /**< The longest gap counted as playtime, or 0 for no limit. */
+    const char *joinMarkers[MC_MAX_MARKERS];   /**< The texts marking lines at which a session starts. */
+    int joinMarkerCount;                        /**< The number of join markers. */
+    const char *leaveMarkers[MC_MAX_MARKERS];  /**< The texts marking lines at which a session ends. */
+    int leaveMarkerCount;                       /**< The number of leave markers. */
+    int tailSeek;                               /**< Whether end times may be taken from the tail of a file. */
+    int jobs;                                   /**< The number of threads an indexed file is parsed on. */
+    McThreadBudget *threads;                    /**< The budget of the threads beyond the caller, or NULL. */
+    int timing;                                 /**< Whether the time of each phase is measured into the stats. */
+    size_t memoryLimit;                         /**< The most memory a parser holds a file in, or 0 for no limit. */
+} McOptions;
+/** The number of days of a log file that its histogram tells apart. Later days are counted on the last one. */
+#define MC_HISTOGRAM_DAYS 8
+/**
+ * @brief The playtime of a log file by day and by hour of the day.
+ */
+typedef struct
+{
+    time_t days[MC_HISTOGRAM_DAYS];  /**< The playtime on each day, from the day of the first timestamp on. */
+    time_t hours[24];                /**< The playtime within each hour of the day. */
+} McHistogram;
+/**
+ * @brief The times recorded by a log file.
+ */
+typedef struct
+{
+    time_t start;           /**< The first timestamp. */
+    time_t end;             /**< The last timestamp. */
+    time_t time;            /**< The playtime. */
+    int days;               /**< The number of midnights passed. */
+    int sessions;           /**< The number of sessions. */
+    int active;             /**< Whether a session is still open at the end. */
+    long long bytes;        /**< The number of bytes of log text covered. */
+    McHistogram histogram;  /**< The playtime by day and by hour. */
+} McSummary;
+/**
+ * @brief The version of a file that a result or an index belongs to.
+ */
+typedef struct
+{
+    unsigned long long inode;  /**< The inode number. */
+    long long size;            /**< The size in bytes. */
+    long long mtime;           /**< The modification time. */
+} McFileStamp;
+/**
+ * @brief A phase of the work whose time is measured.
+ */
+typedef enum
+{
+    MC_PHASE_ENUMERATE,  /**< Listing directories, which parsers don't do but callers can time. */
+    MC_PHASE_OPEN,       /**< Opening, stating and closing files. */
+    MC_PHASE_INFLATE,    /**< Reading and decompressing data. */
+    MC_PHASE_SCAN,       /**< Splitting lines and parsing timestamps. */
+    MC_PHASE_COUNT
+} McPhase;
+/**
+ * @brief The counters of a parser.
+ */
+typedef struct
+{
+    double wall[MC_PHASE_COUNT];  /**< The wall time of each phase, if `timing` is set. */
+    double cpu[MC_PHASE_COUNT];   /**< The CPU time of each phase, if `timing` is set. */
+    long long lines;              /**< The number of lines scanned. */
+    long long compressedBytes;    /**< The number of bytes of files parsed. */
+    long long decompressedBytes;  /**< The number of bytes of log text scanned. */
+} McStats;
+/**
+ * @brief A point in time from which the time of a phase is measured.
+ */
+typedef struct
+{
+    double wall;         /**< The wall time. */
+    double cpu;          /**< The CPU time of the current thread. */
+    double inflateWall;  /**< The wall time of the inflate phase so far. */
+    double inflateCpu;   /**< The CPU time of the inflate phase so far. */
+} McClock;
+/**
+ * @brief The state of splitting the lines of a log file into sessions in one pass.
+ * @note The fields are only exposed so that it can live on the stack.
+ */
+typedef struct
+{
+    const McOptions *options;  /**< The options, which must outlive the sessions. */
+    int format;                /**< The format of the log file, or -1 while it is being detected. */
+    int detected;              /**< The number of lines the format has been detected on. */
+    int found;                 /**< Whether a timestamp has been found. */
+    int active;                /**< Whether a session is open. */
+    time_t first;              /**< The first timestamp. */
+    time_t last;               /**< The latest timestamp. */
+    time_t time;               /**< The playtime of the sessions so far. */
+    int days;                  /**< The number of midnights passed. */
+    int sessions;              /**< The number of sessions started. */
+    McHistogram histogram;     /**< The playtime of the sessions so far by day and by hour. */
+} McSessions;
+/** A parser of log files. */
+typedef struct McParser McParser;
+/**
+ * @brief Set options to their defaults: no gap, no markers, no tail seeking, one job, no thread budget and no memory
+ * limit.
+ * @param[out] options The options.
+ */
+void mcInitOptions(McOptions *options);
+/**
+ * @brief Create a budget of threads.
+ * @param[in] threads The number of threads, which the threads that take from it hold between them.
+ * @return Return the budget, or NULL on failure.
+ */
+McThreadBudget *mcCreateThreadBudget(int threads);
+/**
+ * @brief Free a budget of threads.
+ * @param[in] budget The budget, or NULL.
+ */
+void mcFreeThreadBudget(McThreadBudget *budget);
+/**
+ * @brief Take threads from a budget without waiting.
+ * @param[in,out] budget The budget.
+ * @param[in] wanted The most threads to take.
+ * @return Return the number of threads taken, which may be fewer than `wanted` or 0.
+ */
+int mcTakeThreads(McThreadBudget *budget, int wanted);
+/**
+ * @brief Give threads back to a budget.
+ * @param[in,out] budget The budget.
+ * @param[in] count The number of threads taken by `mcTakeThreads()` that are given back.
+ */
+void mcReturnThreads(McThreadBudget *budget, int count);
+/**
+ * @brief Create a parser.
+ * @param[in] options The options, which are copied. The marker texts must outlive the parser.
+ * @return Return the parser, or NULL on failure.
+ */
+McParser *mcCreateParser(const McOptions *options);
+/**
+ * @brief Free a parser.
+ * @param[in] parser The parser, or NULL.
+ */
+void mcFreeParser(McParser *parser);
+/**
+ * @brief Parse a log file, which may be plain or gzip-compressed.
+ * @param[in,out] parser The parser.
+ * @param[in] path The path to the log file.
+ * @param[out] summary The times recorded by the log file.
+ * @return Return 0 on success, 1 on system failure, or 2 if it isn't a minecraft log file.
+ */
+int mcParseFile(McParser *parser, const char *path, McSummary *summary);
+/**
+ * @brief Parse a log file in memory, which may be plain or gzip-compressed.
+ * @param[in,out] parser The parser.
+ * @param[in] data The content of the log file.
+ * @param[in] size The size of the content.
+ * @param[out] summary The times recorded by the log file.
+ * @return Return 0 on success, 1 on system failure, or 2 if it isn't a minecraft log file.
+ */
+int mcParseBuffer(McParser *parser, const void *data, size_t size, McSummary *summary);
+/**
+ * @brief Parse a large gzip file through its access point index, or build the index while parsing it.
+ * @param[in,out] parser The parser.
+ * @param[in] path The path to the gzip file.
+ * @param[in] indexPath The path to the index file, whose directory must exist.
+ * @param[out] summary The times recorded by the log file.
+ * @return Return 0 on success, 1 on system failure, 2 if it isn't a minecraft log file, or -1 if the file should be
+ * parsed by `mcParseFile()` instead.
+ * @note The calling thread counts as one of the `jobs` threads. With a thread budget, the others are only started as
+ * far as the budget has threads left, so parsers parsing several files at once don't oversubscribe the CPUs. An
+ * existing index only pays off with several jobs or tail seeking, and can't be used with join or leave
+ * markers. The index is only valid on the machine that has written it.
+ */
+int mcParseIndexed(McParser *parser, const char *path, const char *indexPath, McSummary *summary);
+/**
+ * @brief Add the counters of a parser to `stats` and reset them.
+ * @param[in,out] parser The parser.
+ * @param[in,out] stats The counters to add to.
+ */
+void mcCollectStats(McParser *parser, McStats *stats);
+#ifdef ENABLE_STATS
+/**
+ * @brief Read a clock in seconds.
+ * @param[in] id The clock.
+ * @return Return the time of the clock.
+ */
+double mcReadClock(clockid_t id);
+/**
+ * @brief Start measuring a phase.
+ * @param[out] clock The clock.
+ * @param[in] stats The counters that the time will be added to.
+ */
+void mcStartClock(McClock *clock, const McStats *stats);
+/**
+ * @brief Stop measuring a phase and add its time to the counters.
+ * @param[in] clock The clock.
+ * @param[in,out] stats The counters.
+ * @param[in] phase The phase.
+ * @note The time spent in the inflate phase in the meantime is excluded from the scan phase.
+ */
+void mcStopClock(const McClock *clock, McStats *stats, McPhase phase);
+#endif
+/**
+ * @brief Find the line feeds in a block of text with the fastest kernel of the CPU: AVX2, SSE2, NEON or a byte loop.
+ * @param[in] data The text.
+ * @param[in] size The size of the text.
+ * @param[out] offsets The offsets of the line feeds in the text.
+ * @param[in] max The most line feeds to find.
+ * @return Return the number of line feeds found, which is less than `max` only if there are no more.
+ */
+size_t mcFindNewlines(const char *data, size_t size, size_t *offsets, size_t max);
+/**
+ * @brief Get the name of the kernel used by `mcFindNewlines()`.
+ * @return Return "avx2", "sse2", "neon" or "scalar".
+ */
+const char *mcNewlineKernel(void);
+/**
+ * @brief Convert a date to the number of days since 1970-01-01.
+ * @param[in] date The date in the form of `yyyy-MM-dd`, whose digits must have been validated.
+ * @return Return the number of days.
+ */
+time_t mcGetDayNumber(const char *date);
+/**
+ * @brief Start splitting a log file into sessions.
+ * @param[out] sessions The sessions.
+ * @param[in] options The options, which must outlive the sessions.
+ */
+void mcStartSessions(McSessions *sessions, const McOptions *options);
+/**
+ * @brief Continue splitting a log file into sessions from a previous result, e.g. when it has grown.
+ * @param[out] sessions The sessions.
+ * @param[in] options The options, which must outlive the sessions.
+ * @param[in] summary The result of the lines so far.
+ */
+void mcResumeSessions(McSessions *sessions, const McOptions *options, const McSummary *summary);
+/**
+ * @brief Feed a line of a log file to the sessions.
+ * @param[in,out] sessions The sessions.
+ * @param[in] line The start of the line.
+ * @param[in] length The length of the line without the line feed.
+ * @return Return 1 if the line has a timestamp, or 0 otherwise.
+ */
+int mcAddLine(McSessions *sessions, const char *line, size_t length);
+/**
+ * @brief Get the times of the lines fed to the sessions. The `bytes` of the summary are left as they are.
+ * @param[in] sessions The sessions.
+ * @param[out] summary The summary whose times are filled in.
+ */
+void mcFinishSessions(const McSessions *sessions, McSummary *summary);
+#ifdef __cplusplus
+}
+#endif
+#endif